@@ -0,0 +1,266 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Colour conversion throughput of the client frame output, per core.
+ * Converts the same synthetic YUV420P pictures to the output format three ways: one sws_scale over the whole
+ * picture (the way RtspClient converted before FrameConverter), FrameConverter with the fast path off (sliced
+ * sws_scale), and FrameConverter with its fast path, each at 1, 2, 4, ... up to max_threads slices.
+ * Reported per run: frames per second, frames per second per thread, speedup over the single sws_scale,
+ * and the largest difference of any channel from the sws_scale output.
+ *
+ * usage: convert_bench [-s widthxheight] [-o bgr24|rgba] [-n frames_per_run] [-t max_threads] [-f table|csv]
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
+#include <libswscale/swscale.h>
+#include "../rtsp/frame_converter.h"
+
+/* distinct pictures, so the runs do not convert one picture that stays in the cache */
+#define BENCH_PICTURES 8
+
+typedef struct BenchOptions {
+    int width;
+    int height;
+    enum AVPixelFormat output;
+    uint32_t frames;
+    uint32_t max_threads;
+    const char *format;
+} BenchOptions;
+
+typedef struct BenchResult {
+    const char *path;
+    uint32_t threads;
+    double fps;
+    int max_diff;
+} BenchResult;
+
+static inline uint64_t now_nanos() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+static AVFrame *alloc_picture(enum AVPixelFormat format, int width, int height) {
+    AVFrame *frame = av_frame_alloc();
+    if (!frame) {
+        return NULL;
+    }
+    frame->format = format;
+    frame->width = width;
+    frame->height = height;
+    if (av_frame_get_buffer(frame, 32) < 0) {
+        av_frame_free(&frame);
+    }
+    return frame;
+}
+
+/* gradients with some noise, every value of every plane shows up */
+static void fill_picture(AVFrame *frame, uint32_t seed) {
+    for (int plane = 0; plane < 3; ++plane) {
+        int width = plane ? frame->width / 2 : frame->width, height = plane ? frame->height / 2 : frame->height;
+        for (int y = 0; y < height; ++y) {
+            uint8_t *row = frame->data[plane] + y * frame->linesize[plane];
+            for (int x = 0; x < width; ++x) {
+                seed = seed * 1103515245 + 12345;
+                row[x] = (uint8_t) ((x * 255 / width + y * 255 / height) / 2 + (seed >> 28) + plane * 40);
+            }
+        }
+    }
+}
+
+static int max_difference(const AVFrame *a, const AVFrame *b, int pixel_size) {
+    int max_diff = 0;
+    for (int y = 0; y < a->height; ++y) {
+        const uint8_t *row_a = a->data[0] + y * a->linesize[0], *row_b = b->data[0] + y * b->linesize[0];
+        for (int x = 0; x < a->width * pixel_size; ++x) {
+            int diff = abs(row_a[x] - row_b[x]);
+            if (diff > max_diff) {
+                max_diff = diff;
+            }
+        }
+    }
+    return max_diff;
+}
+
+/* the whole picture through one context, on the calling thread */
+static bool run_sws_scale(const BenchOptions *options, AVFrame **pictures, AVFrame *output, BenchResult *result) {
+    struct SwsContext *context = sws_getContext(options->width, options->height, AV_PIX_FMT_YUV420P,
+                                                options->width, options->height, options->output,
+                                                SWS_BICUBIC, NULL, NULL, NULL);
+    if (!context) {
+        fprintf(stderr, "sws_getContext failed\n");
+        return false;
+    }
+    uint64_t start = now_nanos();
+    for (uint32_t i = 0; i < options->frames; ++i) {
+        const AVFrame *picture = pictures[i % BENCH_PICTURES];
+        sws_scale(context, (const uint8_t *const *) picture->data, picture->linesize, 0, options->height,
+                  output->data, output->linesize);
+    }
+    result->fps = options->frames / ((double) (now_nanos() - start) / 1e9);
+    result->path = "sws_scale";
+    result->threads = 1;
+    result->max_diff = 0;
+    sws_freeContext(context);
+    return true;
+}
+
+static bool run_converter(const BenchOptions *options, AVFrame **pictures, AVFrame *output,
+                          const AVFrame *reference, uint32_t threads, bool fast_path, BenchResult *result) {
+    FrameConverter *converter = create_frame_converter(threads, SWS_BICUBIC);
+    if (!converter) {
+        fprintf(stderr, "create_frame_converter failed\n");
+        return false;
+    }
+    set_frame_converter_fast_path(converter, fast_path);
+    bool ok = true;
+    uint64_t start = now_nanos();
+    for (uint32_t i = 0; ok && i < options->frames; ++i) {
+        ok = convert_frame(converter, pictures[i % BENCH_PICTURES], output) == 0;
+    }
+    result->fps = options->frames / ((double) (now_nanos() - start) / 1e9);
+    result->path = fast_path ? "fast path" : "sliced sws_scale";
+    result->threads = threads;
+    /* the sws_scale run ended on the same picture */
+    result->max_diff = max_difference(output, reference, options->output == AV_PIX_FMT_BGR24 ? 3 : 4);
+    destroy_frame_converter(converter);
+    if (!ok) {
+        fprintf(stderr, "convert_frame failed\n");
+    }
+    return ok;
+}
+
+/************************* output *************************/
+
+static void print_header(const BenchOptions *options) {
+    if (strcmp(options->format, "csv") == 0) {
+        printf("path,threads,width,height,output,frames,fps,fps_per_thread,speedup,max_diff\n");
+    } else {
+        printf("%dx%d yuv420p -> %s, %u frames per run\n", options->width, options->height,
+               options->output == AV_PIX_FMT_BGR24 ? "bgr24" : "rgba", options->frames);
+        printf("%-18s %8s %10s %12s %8s %9s\n", "path", "threads", "fps", "fps/thread", "speedup", "max-diff");
+    }
+}
+
+static void print_result(const BenchOptions *options, const BenchResult *result, double baseline_fps) {
+    double per_thread = result->fps / result->threads;
+    double speedup = baseline_fps > 0 ? result->fps / baseline_fps : 0;
+    if (strcmp(options->format, "csv") == 0) {
+        printf("%s,%u,%d,%d,%s,%u,%.2f,%.2f,%.3f,%d\n", result->path, result->threads, options->width,
+               options->height, options->output == AV_PIX_FMT_BGR24 ? "bgr24" : "rgba", options->frames,
+               result->fps, per_thread, speedup, result->max_diff);
+    } else {
+        printf("%-18s %8u %10.2f %12.2f %7.2fx %9d\n", result->path, result->threads, result->fps, per_thread,
+               speedup, result->max_diff);
+    }
+    fflush(stdout);
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "usage: %s [-s widthxheight] [-o bgr24|rgba] [-n frames_per_run] [-t max_threads] "
+                    "[-f table|csv]\n", program);
+}
+
+int main(int argc, char **argv) {
+    BenchOptions options = { 1920, 1080, AV_PIX_FMT_BGR24, 200, 0, "table" };
+    int option;
+    while ((option = getopt(argc, argv, "s:o:n:t:f:h")) != -1) {
+        switch (option) {
+            case 's':
+                if (sscanf(optarg, "%dx%d", &options.width, &options.height) != 2) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'o':
+                if (strcmp(optarg, "bgr24") == 0) {
+                    options.output = AV_PIX_FMT_BGR24;
+                } else if (strcmp(optarg, "rgba") == 0) {
+                    options.output = AV_PIX_FMT_RGBA;
+                } else {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'n':
+                options.frames = (uint32_t) strtoul(optarg, NULL, 10);
+                break;
+            case 't':
+                options.max_threads = (uint32_t) strtoul(optarg, NULL, 10);
+                break;
+            case 'f':
+                options.format = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (options.width <= 0 || options.height <= 0 || options.width % 2 || options.height % 2
+        || options.frames == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (options.max_threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        options.max_threads = (uint32_t) (cpus > 0 ? cpus : 1);
+    }
+
+    AVFrame *pictures[BENCH_PICTURES] = { NULL };
+    AVFrame *output = alloc_picture(options.output, options.width, options.height);
+    AVFrame *reference = alloc_picture(options.output, options.width, options.height);
+    bool ok = output && reference;
+    for (uint32_t i = 0; ok && i < BENCH_PICTURES; ++i) {
+        if ((ok = (pictures[i] = alloc_picture(AV_PIX_FMT_YUV420P, options.width, options.height)) != NULL)) {
+            fill_picture(pictures[i], i + 1);
+        }
+    }
+
+    BenchResult result;
+    ok = ok && run_sws_scale(&options, pictures, reference, &result);
+    if (ok) {
+        double baseline_fps = result.fps;
+        print_header(&options);
+        print_result(&options, &result, baseline_fps);
+        for (int fast_path = 0; ok && fast_path <= 1; ++fast_path) {
+            for (uint32_t threads = 1;; threads = threads * 2 < options.max_threads ? threads * 2 : options.max_threads) {
+                if ((ok = run_converter(&options, pictures, output, reference, threads, fast_path, &result))) {
+                    print_result(&options, &result, baseline_fps);
+                }
+                if (!ok || threads >= options.max_threads) {
+                    break;
+                }
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < BENCH_PICTURES; ++i) {
+        av_frame_free(&pictures[i]);
+    }
+    av_frame_free(&output);
+    av_frame_free(&reference);
+    return ok ? 0 : 1;
+}
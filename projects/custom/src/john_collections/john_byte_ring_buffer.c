@@ -0,0 +1,266 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * One shared memory object of capacity bytes is mapped at base and again at base + capacity,
+ * so base[i] and base[i + capacity] are the same byte. read_index and write_index only ever grow,
+ * offset = index & mask; a view never exceeds capacity bytes, so it never leaves the double mapping.
+ * The mutex/condition pair is touched only when one side has to wait for the other.
+ * Note: We did not check if the pthread related function call succeeded
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#ifdef __linux__
+#define _GNU_SOURCE /* memfd_create */
+#endif
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include <memory.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "john_byte_ring_buffer.h"
+
+#define JOHN_CACHE_LINE_SIZE 64
+
+struct JohnByteRingBuffer {
+    atomic_ullong write_index; /* written by writer */
+    char write_padding[JOHN_CACHE_LINE_SIZE - sizeof(atomic_ullong)];
+    atomic_ullong read_index; /* written by reader */
+    char read_padding[JOHN_CACHE_LINE_SIZE - sizeof(atomic_ullong)];
+    atomic_int reader_waiting;
+    atomic_int writer_waiting;
+    char waiting_padding[JOHN_CACHE_LINE_SIZE - 2 * sizeof(atomic_int)];
+
+    uint8_t *base; /* 2 * capacity bytes of address space */
+    uint32_t capacity;
+    uint32_t mask;
+
+    pthread_mutex_t lock;
+    pthread_cond_t readable_condition;
+    pthread_cond_t writable_condition;
+};
+
+static int john_byte_ring_buffer_open_shared_memory(void) {
+#ifdef __linux__
+    return memfd_create("john_byte_ring_buffer", MFD_CLOEXEC);
+#else
+    static atomic_uint sequence;
+    char name[64];
+    snprintf(name, sizeof(name), "/john_byte_ring_%ld_%u", (long) getpid(), atomic_fetch_add(&sequence, 1));
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0) {
+        shm_unlink(name); /* only the mappings keep it alive */
+    }
+    return fd;
+#endif
+}
+
+static uint8_t *john_byte_ring_buffer_map(uint32_t capacity) {
+    uint8_t *base = NULL;
+    int fd = john_byte_ring_buffer_open_shared_memory();
+    if (fd < 0) {
+        return NULL;
+    }
+    if (ftruncate(fd, capacity) != 0) {
+        goto done;
+    }
+    /* reserve the whole range first so that nobody else can map into the gap */
+    void *region = mmap(NULL, (size_t) capacity * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+        goto done;
+    }
+    if (mmap(region, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap((uint8_t *) region + capacity, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) ==
+        MAP_FAILED) {
+        munmap(region, (size_t) capacity * 2);
+        goto done;
+    }
+    base = (uint8_t *) region;
+done:
+    close(fd);
+    return base;
+}
+
+static void john_byte_ring_buffer_deadline(struct timespec *deadline, int32_t timeout_millis) {
+    clock_gettime(CLOCK_REALTIME, deadline);
+    deadline->tv_sec += timeout_millis / 1000;
+    deadline->tv_nsec += (timeout_millis % 1000) * 1000000;
+    if (deadline->tv_nsec >= 1000000000) {
+        ++deadline->tv_sec;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+static inline uint32_t john_byte_ring_buffer_used(JohnByteRingBuffer *ring_buffer) {
+    return (uint32_t) (atomic_load(&ring_buffer->write_index) - atomic_load(&ring_buffer->read_index));
+}
+
+JohnByteRingBuffer *john_byte_ring_buffer_create(uint32_t capacity) {
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (capacity == 0 || capacity > (1U << 31) || page_size <= 0) {
+        return NULL;
+    }
+    uint32_t power_of_two = (uint32_t) page_size;
+    while (power_of_two < capacity) {
+        power_of_two <<= 1;
+    }
+
+    JohnByteRingBuffer *ring_buffer = (JohnByteRingBuffer *) malloc(sizeof(JohnByteRingBuffer));
+    if (ring_buffer) {
+        memset(ring_buffer, 0, sizeof(JohnByteRingBuffer));
+        ring_buffer->base = john_byte_ring_buffer_map(power_of_two);
+        if (!ring_buffer->base) {
+            free(ring_buffer);
+            return NULL;
+        }
+        ring_buffer->capacity = power_of_two;
+        ring_buffer->mask = power_of_two - 1;
+        atomic_init(&ring_buffer->write_index, 0);
+        atomic_init(&ring_buffer->read_index, 0);
+        atomic_init(&ring_buffer->reader_waiting, 0);
+        atomic_init(&ring_buffer->writer_waiting, 0);
+
+        pthread_mutex_init(&ring_buffer->lock, NULL);
+        pthread_cond_init(&ring_buffer->readable_condition, NULL);
+        pthread_cond_init(&ring_buffer->writable_condition, NULL);
+    }
+    return ring_buffer;
+}
+
+void john_byte_ring_buffer_destroy(JohnByteRingBuffer *ring_buffer) {
+    if (ring_buffer) {
+        pthread_cond_destroy(&ring_buffer->writable_condition);
+        pthread_cond_destroy(&ring_buffer->readable_condition);
+        pthread_mutex_destroy(&ring_buffer->lock);
+
+        munmap(ring_buffer->base, (size_t) ring_buffer->capacity * 2);
+        ring_buffer->base = NULL;
+        free(ring_buffer);
+    }
+}
+
+uint8_t *john_byte_ring_buffer_reserve(JohnByteRingBuffer *ring_buffer, uint32_t size, int32_t timeout_millis) {
+    if (!ring_buffer || size > ring_buffer->capacity) {
+        return NULL;
+    }
+    if (ring_buffer->capacity - john_byte_ring_buffer_used(ring_buffer) < size && timeout_millis != 0) {
+        struct timespec deadline;
+        if (timeout_millis > 0) {
+            john_byte_ring_buffer_deadline(&deadline, timeout_millis);
+        }
+        int rc = 0;
+        pthread_mutex_lock(&ring_buffer->lock);
+        while (true) {
+            /* pairs with the seq_cst store of read_index and load of writer_waiting in consume() */
+            atomic_store(&ring_buffer->writer_waiting, 1);
+            if (ring_buffer->capacity - john_byte_ring_buffer_used(ring_buffer) >= size || rc == ETIMEDOUT) {
+                break;
+            }
+            if (timeout_millis < 0) {
+                pthread_cond_wait(&ring_buffer->writable_condition, &ring_buffer->lock);
+            } else {
+                rc = pthread_cond_timedwait(&ring_buffer->writable_condition, &ring_buffer->lock, &deadline);
+            }
+        }
+        atomic_store(&ring_buffer->writer_waiting, 0);
+        pthread_mutex_unlock(&ring_buffer->lock);
+    }
+    if (ring_buffer->capacity - john_byte_ring_buffer_used(ring_buffer) < size) { /* is full */
+        return NULL;
+    }
+    return ring_buffer->base + (atomic_load_explicit(&ring_buffer->write_index, memory_order_relaxed) & ring_buffer->mask);
+}
+
+void john_byte_ring_buffer_commit(JohnByteRingBuffer *ring_buffer, uint32_t size) {
+    if (!ring_buffer || size == 0) {
+        return;
+    }
+    atomic_fetch_add(&ring_buffer->write_index, size);
+    if (atomic_load(&ring_buffer->reader_waiting)) {
+        pthread_mutex_lock(&ring_buffer->lock);
+        pthread_cond_signal(&ring_buffer->readable_condition);
+        pthread_mutex_unlock(&ring_buffer->lock);
+    }
+}
+
+bool john_byte_ring_buffer_write(JohnByteRingBuffer *ring_buffer, const uint8_t *data, uint32_t size,
+                                 int32_t timeout_millis) {
+    uint8_t *reservation = john_byte_ring_buffer_reserve(ring_buffer, size, timeout_millis);
+    if (!reservation) {
+        return false;
+    }
+    memcpy(reservation, data, size);
+    john_byte_ring_buffer_commit(ring_buffer, size);
+    return true;
+}
+
+uint8_t *john_byte_ring_buffer_read_view(JohnByteRingBuffer *ring_buffer, uint32_t *size, int32_t timeout_millis) {
+    if (!ring_buffer || !size) {
+        return NULL;
+    }
+    if (john_byte_ring_buffer_used(ring_buffer) == 0 && timeout_millis != 0) {
+        struct timespec deadline;
+        if (timeout_millis > 0) {
+            john_byte_ring_buffer_deadline(&deadline, timeout_millis);
+        }
+        int rc = 0;
+        pthread_mutex_lock(&ring_buffer->lock);
+        while (true) {
+            /* pairs with the seq_cst store of write_index and load of reader_waiting in commit() */
+            atomic_store(&ring_buffer->reader_waiting, 1);
+            if (john_byte_ring_buffer_used(ring_buffer) > 0 || rc == ETIMEDOUT) {
+                break;
+            }
+            if (timeout_millis < 0) {
+                pthread_cond_wait(&ring_buffer->readable_condition, &ring_buffer->lock);
+            } else {
+                rc = pthread_cond_timedwait(&ring_buffer->readable_condition, &ring_buffer->lock, &deadline);
+            }
+        }
+        atomic_store(&ring_buffer->reader_waiting, 0);
+        pthread_mutex_unlock(&ring_buffer->lock);
+    }
+    *size = john_byte_ring_buffer_used(ring_buffer);
+    if (*size == 0) { /* is empty */
+        return NULL;
+    }
+    return ring_buffer->base + (atomic_load_explicit(&ring_buffer->read_index, memory_order_relaxed) & ring_buffer->mask);
+}
+
+void john_byte_ring_buffer_consume(JohnByteRingBuffer *ring_buffer, uint32_t size) {
+    if (!ring_buffer || size == 0) {
+        return;
+    }
+    atomic_fetch_add(&ring_buffer->read_index, size);
+    if (atomic_load(&ring_buffer->writer_waiting)) {
+        pthread_mutex_lock(&ring_buffer->lock);
+        pthread_cond_signal(&ring_buffer->writable_condition);
+        pthread_mutex_unlock(&ring_buffer->lock);
+    }
+}
+
+uint32_t john_byte_ring_buffer_capacity(JohnByteRingBuffer *ring_buffer) {
+    return ring_buffer ? ring_buffer->capacity : 0;
+}
+
+uint32_t john_byte_ring_buffer_readable(JohnByteRingBuffer *ring_buffer) {
+    return ring_buffer ? john_byte_ring_buffer_used(ring_buffer) : 0;
+}
@@ -0,0 +1,60 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Byte ring buffer for exactly one writer thread and one reader thread.
+ * The storage is mapped twice back to back, so every reservation and every read view is
+ * contiguous even when it wraps around the end of the ring: variable-length payloads
+ * (e.g. Annex-B NAL units) can be produced and consumed in place without a split copy.
+ * Capacity is rounded up to a power of two and at least one page.
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#ifndef __JOHN_BYTE_RING_BUFFER_H__
+#define __JOHN_BYTE_RING_BUFFER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct JohnByteRingBuffer JohnByteRingBuffer;
+
+JohnByteRingBuffer *john_byte_ring_buffer_create(uint32_t capacity);
+void john_byte_ring_buffer_destroy(JohnByteRingBuffer *ring_buffer);
+/* writer thread only; returns room for size contiguous bytes, or NULL on timeout or if size > capacity;
+ * timeout_millis: 0 no wait, < 0 wait forever */
+uint8_t *john_byte_ring_buffer_reserve(JohnByteRingBuffer *ring_buffer, uint32_t size, int32_t timeout_millis);
+/* writer thread only; publishes the first size bytes of the last reservation */
+void john_byte_ring_buffer_commit(JohnByteRingBuffer *ring_buffer, uint32_t size);
+/* writer thread only; reserve + memcpy + commit */
+bool john_byte_ring_buffer_write(JohnByteRingBuffer *ring_buffer, const uint8_t *data, uint32_t size,
+                                 int32_t timeout_millis);
+/* reader thread only; returns every readable byte as one contiguous view, or NULL on timeout */
+uint8_t *john_byte_ring_buffer_read_view(JohnByteRingBuffer *ring_buffer, uint32_t *size, int32_t timeout_millis);
+/* reader thread only; releases the first size bytes of the view back to the writer */
+void john_byte_ring_buffer_consume(JohnByteRingBuffer *ring_buffer, uint32_t size);
+uint32_t john_byte_ring_buffer_capacity(JohnByteRingBuffer *ring_buffer);
+/* snapshot, may be stale under concurrent use */
+uint32_t john_byte_ring_buffer_readable(JohnByteRingBuffer *ring_buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JOHN_BYTE_RING_BUFFER_H__ */
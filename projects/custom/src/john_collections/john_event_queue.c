@@ -0,0 +1,217 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * armed == true means the descriptor has been (or is about to be) made readable.
+ * Producer: enqueue, seq_cst fence, then whoever flips armed false -> true writes the descriptor.
+ * Consumer: when it finds the queue empty it clears the descriptor first, then disarms, then after
+ * a seq_cst fence checks the queue once more and re-arms if a producer slipped in. Clearing before
+ * disarming means a write that follows a disarm is never read away; the two fences mean that either
+ * the consumer's recheck sees the element or the producer's exchange sees armed == false and writes.
+ * The descriptor can be spuriously readable, but is not left clear while elements are waiting.
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <memory.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+#include "john_mpmc_queue.h"
+#include "john_event_queue.h"
+
+#define JOHN_EVENT_QUEUE_SPIN_MIN_NANOS 1000
+#define JOHN_EVENT_QUEUE_SPIN_MAX_NANOS 200000
+
+struct JohnEventQueue {
+    JohnMpmcQueue *queue;
+    void *return_on_empty;
+    atomic_bool armed;
+    atomic_long spin_nanos; /* adapted by dequeue: grows when spinning paid off, shrinks when it did not */
+    int read_fd;
+    int write_fd;
+};
+
+static inline int64_t john_event_queue_monotonic_nanos() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void john_event_queue_signal(JohnEventQueue *event_queue) {
+    /* pairs with the fence in john_event_queue_poll, the enqueue is visible to its recheck or armed == false here */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_exchange(&event_queue->armed, true)) {
+#if defined(__linux__)
+        uint64_t value = 1;
+        ssize_t rc = write(event_queue->write_fd, &value, sizeof(value));
+#else
+        char value = 1;
+        ssize_t rc = write(event_queue->write_fd, &value, sizeof(value));
+#endif
+        (void) rc; /* EAGAIN: already readable */
+    }
+}
+
+static void john_event_queue_clear_fd(JohnEventQueue *event_queue) {
+#if defined(__linux__)
+    uint64_t value;
+    ssize_t rc = read(event_queue->read_fd, &value, sizeof(value));
+    (void) rc;
+#else
+    char buffer[64];
+    while (read(event_queue->read_fd, buffer, sizeof(buffer)) > 0);
+#endif
+}
+
+JohnEventQueue *john_event_queue_create(uint32_t capacity, bool replace_oldest, void *return_on_empty) {
+    JohnEventQueue *event_queue = (JohnEventQueue *) malloc(sizeof(JohnEventQueue));
+    if (event_queue) {
+        memset(event_queue, 0, sizeof(JohnEventQueue));
+        event_queue->return_on_empty = return_on_empty;
+        atomic_init(&event_queue->armed, false);
+        atomic_init(&event_queue->spin_nanos, JOHN_EVENT_QUEUE_SPIN_MAX_NANOS / 4);
+        event_queue->queue = john_mpmc_queue_create(capacity, replace_oldest, NULL);
+        if (!event_queue->queue) {
+            free(event_queue);
+            return NULL;
+        }
+#if defined(__linux__)
+        event_queue->read_fd = event_queue->write_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (event_queue->read_fd < 0) {
+            goto fail;
+        }
+#else
+        int fds[2];
+        if (pipe(fds) < 0) {
+            goto fail;
+        }
+        for (int i = 0; i < 2; ++i) {
+            fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+            fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+        }
+        event_queue->read_fd = fds[0];
+        event_queue->write_fd = fds[1];
+#endif
+    }
+    return event_queue;
+    fail:
+    john_mpmc_queue_destroy(event_queue->queue);
+    free(event_queue);
+    return NULL;
+}
+
+void john_event_queue_destroy(JohnEventQueue *event_queue) {
+    if (event_queue) {
+        close(event_queue->read_fd);
+        if (event_queue->write_fd != event_queue->read_fd) {
+            close(event_queue->write_fd);
+        }
+        john_mpmc_queue_destroy(event_queue->queue);
+        event_queue->queue = NULL;
+        free(event_queue);
+    }
+}
+
+bool john_event_queue_enqueue(JohnEventQueue *event_queue, void *data, int32_t timeout_millis) {
+    if (event_queue && john_mpmc_queue_enqueue(event_queue->queue, data, timeout_millis)) {
+        john_event_queue_signal(event_queue);
+        return true;
+    }
+    return false;
+}
+
+int john_event_queue_fd(JohnEventQueue *event_queue) {
+    return event_queue ? event_queue->read_fd : -1;
+}
+
+uint32_t john_event_queue_poll(JohnEventQueue *event_queue, void **data, uint32_t max_count) {
+    uint32_t result = 0;
+    if (!event_queue || !data) {
+        return result;
+    }
+    void *element;
+    while (result < max_count && (element = john_mpmc_queue_dequeue(event_queue->queue, 0))) {
+        data[result++] = element;
+    }
+    if (result < max_count) { /* found it empty, go idle */
+        /* clear before disarming: a producer that sees armed == false writes after this read */
+        john_event_queue_clear_fd(event_queue);
+        atomic_store(&event_queue->armed, false);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (!john_mpmc_queue_is_empty(event_queue->queue)) {
+            john_event_queue_signal(event_queue);
+        }
+    }
+    return result;
+}
+
+void *john_event_queue_dequeue(JohnEventQueue *event_queue, int32_t timeout_millis) {
+    void *result = NULL;
+    if (!event_queue) {
+        return result;
+    }
+    if ((result = john_mpmc_queue_dequeue(event_queue->queue, 0))) {
+        return result;
+    } else if (timeout_millis == 0) {
+        return event_queue->return_on_empty;
+    }
+
+    int64_t begin = john_event_queue_monotonic_nanos();
+    int64_t spin_nanos = atomic_load_explicit(&event_queue->spin_nanos, memory_order_relaxed);
+    while (john_event_queue_monotonic_nanos() - begin < spin_nanos) {
+        if ((result = john_mpmc_queue_dequeue(event_queue->queue, 0))) {
+            spin_nanos = spin_nanos * 2 > JOHN_EVENT_QUEUE_SPIN_MAX_NANOS ? JOHN_EVENT_QUEUE_SPIN_MAX_NANOS
+                                                                          : spin_nanos * 2;
+            atomic_store_explicit(&event_queue->spin_nanos, spin_nanos, memory_order_relaxed);
+            return result;
+        }
+        sched_yield();
+    }
+    spin_nanos = spin_nanos / 2 < JOHN_EVENT_QUEUE_SPIN_MIN_NANOS ? JOHN_EVENT_QUEUE_SPIN_MIN_NANOS : spin_nanos / 2;
+    atomic_store_explicit(&event_queue->spin_nanos, spin_nanos, memory_order_relaxed);
+
+    struct pollfd poll_fd;
+    poll_fd.fd = event_queue->read_fd;
+    poll_fd.events = POLLIN;
+    while (true) {
+        if (john_event_queue_poll(event_queue, &result, 1) == 1) {
+            return result;
+        }
+        int wait_millis = -1;
+        if (timeout_millis > 0) {
+            int64_t elapsed_millis = (john_event_queue_monotonic_nanos() - begin) / 1000000;
+            if (elapsed_millis >= timeout_millis) {
+                return event_queue->return_on_empty;
+            }
+            wait_millis = (int) (timeout_millis - elapsed_millis);
+        }
+        if (poll(&poll_fd, 1, wait_millis) < 0 && errno != EINTR) {
+            return event_queue->return_on_empty;
+        }
+    }
+}
+
+bool john_event_queue_is_empty(JohnEventQueue *event_queue) {
+    return event_queue && john_mpmc_queue_is_empty(event_queue->queue);
+}
@@ -0,0 +1,54 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Bounded MPMC queue whose "not empty" state is also exposed as a pollable file descriptor
+ * (eventfd on linux, a pipe elsewhere), so an event loop can wait for it next to its sockets:
+ *     scheduler.setBackgroundHandling(john_event_queue_fd(queue), SOCKET_READABLE, handler, client);
+ * and the handler calls john_event_queue_poll until it returns less than it asked for.
+ * The descriptor is only written on the empty -> not empty transition, not per element.
+ * Threads that prefer to block use john_event_queue_dequeue, which spins for a short adaptive
+ * period before parking in poll(2) on the descriptor.
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#ifndef __JOHN_EVENT_QUEUE_H__
+#define __JOHN_EVENT_QUEUE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct JohnEventQueue JohnEventQueue;
+
+JohnEventQueue *john_event_queue_create(uint32_t capacity, bool replace_oldest, void *return_on_empty);
+void john_event_queue_destroy(JohnEventQueue *event_queue);
+bool john_event_queue_enqueue(JohnEventQueue *event_queue, void *data, int32_t timeout_millis);
+/* readable while the queue may be non-empty, never read or write it directly */
+int john_event_queue_fd(JohnEventQueue *event_queue);
+/* never blocks; takes up to max_count elements and re-arms the descriptor when it leaves the queue empty */
+uint32_t john_event_queue_poll(JohnEventQueue *event_queue, void **data, uint32_t max_count);
+void *john_event_queue_dequeue(JohnEventQueue *event_queue, int32_t timeout_millis);
+bool john_event_queue_is_empty(JohnEventQueue *event_queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JOHN_EVENT_QUEUE_H__ */
@@ -0,0 +1,243 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Frames are numbered by a 64-bit sequence; the ring holds [tail, head) and a reader holds the sequence it
+ * reads next, so a reader never has to be told about a frame being overwritten.
+ * Note: We did not check if the pthread related function call succeeded
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <memory.h>
+#include "john_fanout_ring.h"
+
+#define JOHN_FANOUT_NO_KEY UINT64_MAX
+
+typedef struct JohnFanoutEntry {
+    void *data;
+    uint32_t size;
+    JohnFramePriority priority;
+} JohnFanoutEntry;
+
+struct JohnFanoutReader {
+    uint64_t next; /* sequence of the frame it reads next */
+    bool waiting_for_key;
+    JohnFanoutReaderStats stats;
+};
+
+struct JohnFanoutRing {
+    JohnFanoutEntry *entries; /* frame sequence s lives at s % capacity */
+    uint32_t capacity;
+    uint32_t max_lag;
+    uint64_t head; /* sequence of the next published frame */
+    uint64_t tail; /* sequence of the oldest frame still held */
+    uint64_t newest_key; /* JOHN_FANOUT_NO_KEY if none is held */
+    uint32_t reader_count;
+
+    void *(*retain_func)(void *data, void *user_client_params);
+    void (*release_func)(void *data, void *user_client_params);
+    void *user_client_params;
+
+    pthread_mutex_t lock;
+};
+
+static inline JohnFanoutEntry *john_fanout_ring_at(JohnFanoutRing *fanout_ring, uint64_t sequence) {
+    return &fanout_ring->entries[sequence % fanout_ring->capacity];
+}
+
+/* must hold lock */
+static void john_fanout_ring_release_tail(JohnFanoutRing *fanout_ring) {
+    JohnFanoutEntry *entry = john_fanout_ring_at(fanout_ring, fanout_ring->tail);
+    if (fanout_ring->release_func) {
+        fanout_ring->release_func(entry->data, fanout_ring->user_client_params);
+    }
+    entry->data = NULL;
+    if (fanout_ring->newest_key == fanout_ring->tail) {
+        fanout_ring->newest_key = JOHN_FANOUT_NO_KEY;
+    }
+    ++fanout_ring->tail;
+}
+
+/* must hold lock; moves the reader to the newest key frame, or to the head to wait for the next one */
+static void john_fanout_ring_skip_to_key(JohnFanoutRing *fanout_ring, JohnFanoutReader *reader) {
+    uint64_t target;
+    if (fanout_ring->newest_key != JOHN_FANOUT_NO_KEY && fanout_ring->newest_key >= reader->next) {
+        target = fanout_ring->newest_key;
+        reader->waiting_for_key = false;
+    } else {
+        target = fanout_ring->head;
+        reader->waiting_for_key = true;
+    }
+    reader->stats.skipped_frames += target - reader->next;
+    reader->next = target;
+}
+
+JohnFanoutRing *john_fanout_ring_create(uint32_t capacity, uint32_t max_lag,
+                                        void *(*retain_func)(void *data, void *user_client_params),
+                                        void (*release_func)(void *data, void *user_client_params),
+                                        void *user_client_params) {
+    if (capacity == 0) {
+        return NULL;
+    }
+    JohnFanoutRing *fanout_ring = (JohnFanoutRing *) malloc(sizeof(JohnFanoutRing));
+    if (fanout_ring == NULL) {
+        return NULL;
+    }
+    memset(fanout_ring, 0, sizeof(JohnFanoutRing));
+    fanout_ring->entries = (JohnFanoutEntry *) calloc(capacity, sizeof(JohnFanoutEntry));
+    if (fanout_ring->entries == NULL) {
+        free(fanout_ring);
+        return NULL;
+    }
+    fanout_ring->capacity = capacity;
+    fanout_ring->max_lag = max_lag;
+    fanout_ring->newest_key = JOHN_FANOUT_NO_KEY;
+    fanout_ring->retain_func = retain_func;
+    fanout_ring->release_func = release_func;
+    fanout_ring->user_client_params = user_client_params;
+    pthread_mutex_init(&fanout_ring->lock, NULL);
+    return fanout_ring;
+}
+
+void john_fanout_ring_destroy(JohnFanoutRing *fanout_ring) {
+    if (fanout_ring == NULL) {
+        return;
+    }
+    john_fanout_ring_clear(fanout_ring);
+    pthread_mutex_destroy(&fanout_ring->lock);
+    free(fanout_ring->entries);
+    free(fanout_ring);
+}
+
+void john_fanout_ring_publish(JohnFanoutRing *fanout_ring, void *data, uint32_t size, JohnFramePriority priority) {
+    pthread_mutex_lock(&fanout_ring->lock);
+    if (fanout_ring->head - fanout_ring->tail == fanout_ring->capacity) {
+        john_fanout_ring_release_tail(fanout_ring);
+    }
+    JohnFanoutEntry *entry = john_fanout_ring_at(fanout_ring, fanout_ring->head);
+    entry->data = data;
+    entry->size = size;
+    entry->priority = priority;
+    if (priority == JOHN_FRAME_KEY) {
+        fanout_ring->newest_key = fanout_ring->head;
+    }
+    ++fanout_ring->head;
+    pthread_mutex_unlock(&fanout_ring->lock);
+}
+
+JohnFanoutReader *john_fanout_ring_open_reader(JohnFanoutRing *fanout_ring) {
+    JohnFanoutReader *reader = (JohnFanoutReader *) malloc(sizeof(JohnFanoutReader));
+    if (reader == NULL) {
+        return NULL;
+    }
+    memset(reader, 0, sizeof(JohnFanoutReader));
+    pthread_mutex_lock(&fanout_ring->lock);
+    reader->next = fanout_ring->tail;
+    john_fanout_ring_skip_to_key(fanout_ring, reader);
+    /* joining is not skipping */
+    memset(&reader->stats, 0, sizeof(JohnFanoutReaderStats));
+    ++fanout_ring->reader_count;
+    pthread_mutex_unlock(&fanout_ring->lock);
+    return reader;
+}
+
+void john_fanout_ring_close_reader(JohnFanoutRing *fanout_ring, JohnFanoutReader *reader) {
+    if (reader == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&fanout_ring->lock);
+    --fanout_ring->reader_count;
+    pthread_mutex_unlock(&fanout_ring->lock);
+    free(reader);
+}
+
+void *john_fanout_ring_read(JohnFanoutRing *fanout_ring, JohnFanoutReader *reader, uint32_t *size) {
+    void *data = NULL;
+    pthread_mutex_lock(&fanout_ring->lock);
+    if (reader->next < fanout_ring->tail
+        || (fanout_ring->max_lag && fanout_ring->head - reader->next > fanout_ring->max_lag
+            && fanout_ring->newest_key != JOHN_FANOUT_NO_KEY && fanout_ring->newest_key > reader->next)) {
+        john_fanout_ring_skip_to_key(fanout_ring, reader);
+        ++reader->stats.key_jumps;
+    }
+    while (reader->waiting_for_key && reader->next < fanout_ring->head) {
+        if (john_fanout_ring_at(fanout_ring, reader->next)->priority == JOHN_FRAME_KEY) {
+            reader->waiting_for_key = false;
+        } else {
+            ++reader->next;
+            ++reader->stats.skipped_frames;
+        }
+    }
+    if (reader->next < fanout_ring->head) {
+        JohnFanoutEntry *entry = john_fanout_ring_at(fanout_ring, reader->next++);
+        data = fanout_ring->retain_func ? fanout_ring->retain_func(entry->data, fanout_ring->user_client_params)
+                                        : entry->data;
+        if (size) {
+            *size = entry->size;
+        }
+        ++reader->stats.read_frames;
+    }
+    pthread_mutex_unlock(&fanout_ring->lock);
+    return data;
+}
+
+uint32_t john_fanout_ring_rewind_to_key(JohnFanoutRing *fanout_ring, JohnFanoutReader *reader) {
+    uint32_t readable = 0;
+    pthread_mutex_lock(&fanout_ring->lock);
+    if (reader->stats.read_frames > 0 && fanout_ring->newest_key != JOHN_FANOUT_NO_KEY
+        && fanout_ring->newest_key < reader->next) {
+        /* the frames before next went out already, the reader goes on from where it is */
+    } else if (fanout_ring->newest_key != JOHN_FANOUT_NO_KEY) {
+        reader->next = fanout_ring->newest_key;
+        reader->waiting_for_key = false;
+        readable = (uint32_t) (fanout_ring->head - reader->next);
+    } else {
+        john_fanout_ring_skip_to_key(fanout_ring, reader);
+    }
+    pthread_mutex_unlock(&fanout_ring->lock);
+    return readable;
+}
+
+bool john_fanout_ring_is_waiting_for_key(JohnFanoutRing *fanout_ring, JohnFanoutReader *reader) {
+    pthread_mutex_lock(&fanout_ring->lock);
+    bool waiting = reader->waiting_for_key;
+    pthread_mutex_unlock(&fanout_ring->lock);
+    return waiting;
+}
+
+void john_fanout_ring_get_reader_stats(JohnFanoutRing *fanout_ring, JohnFanoutReader *reader,
+                                       JohnFanoutReaderStats *stats) {
+    pthread_mutex_lock(&fanout_ring->lock);
+    *stats = reader->stats;
+    pthread_mutex_unlock(&fanout_ring->lock);
+}
+
+uint32_t john_fanout_ring_reader_count(JohnFanoutRing *fanout_ring) {
+    pthread_mutex_lock(&fanout_ring->lock);
+    uint32_t reader_count = fanout_ring->reader_count;
+    pthread_mutex_unlock(&fanout_ring->lock);
+    return reader_count;
+}
+
+void john_fanout_ring_clear(JohnFanoutRing *fanout_ring) {
+    pthread_mutex_lock(&fanout_ring->lock);
+    while (fanout_ring->tail < fanout_ring->head) {
+        john_fanout_ring_release_tail(fanout_ring);
+    }
+    pthread_mutex_unlock(&fanout_ring->lock);
+}
@@ -0,0 +1,77 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Bounded single-writer ring of encoded frames read by any number of readers, each through its own cursor,
+ * so one encoder feeds every client of a live stream. The writer never blocks: the oldest frame is released
+ * once it is overwritten, whether every reader has seen it or not.
+ * A reader starts at the newest key frame in the ring (or skips frames until the next one arrives), and a
+ * reader that falls more than max_lag frames behind, or whose next frame was overwritten, skips ahead to the
+ * newest key frame the same way, so a slow client costs neither the encoder nor the other clients anything.
+ * Every frame handed to a reader is retained for it by retain_func, the reader gives it back by release_func.
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#ifndef __JOHN_FANOUT_RING_H__
+#define __JOHN_FANOUT_RING_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "john_frame_queue.h"
+
+typedef struct JohnFanoutReaderStats {
+    uint64_t read_frames;
+    uint64_t skipped_frames; /* published while the reader was lagging or waiting for a key frame */
+    uint64_t key_jumps;      /* how often the reader lagged and skipped ahead to a key frame */
+} JohnFanoutReaderStats;
+
+typedef struct JohnFanoutRing JohnFanoutRing;
+typedef struct JohnFanoutReader JohnFanoutReader;
+
+/* max_lag 0 means the reader only skips ahead once its next frame was overwritten */
+JohnFanoutRing *john_fanout_ring_create(uint32_t capacity, uint32_t max_lag,
+                                        void *(*retain_func)(void *data, void *user_client_params),
+                                        void (*release_func)(void *data, void *user_client_params),
+                                        void *user_client_params);
+/* User should close every reader before destroy; the frames still in the ring are released */
+void john_fanout_ring_destroy(JohnFanoutRing *fanout_ring);
+/* never blocks, the ring takes over the caller's reference to data */
+void john_fanout_ring_publish(JohnFanoutRing *fanout_ring, void *data, uint32_t size, JohnFramePriority priority);
+JohnFanoutReader *john_fanout_ring_open_reader(JohnFanoutRing *fanout_ring);
+void john_fanout_ring_close_reader(JohnFanoutRing *fanout_ring, JohnFanoutReader *reader);
+/* never blocks; returns the next frame retained for the caller, or NULL if the reader has caught up */
+void *john_fanout_ring_read(JohnFanoutRing *fanout_ring, JohnFanoutReader *reader, uint32_t *size);
+/* moves the reader back (or ahead) to the newest key frame held, e.g. to burst the cached GOP to a client that
+ * starts playing; returns how many frames it can read right away from there, 0 if it waits for the next key frame.
+ * A reader that has read frames already is never moved back behind them, it stays where it is and gets 0. */
+uint32_t john_fanout_ring_rewind_to_key(JohnFanoutRing *fanout_ring, JohnFanoutReader *reader);
+/* true while the reader skips frames until the next key frame is published */
+bool john_fanout_ring_is_waiting_for_key(JohnFanoutRing *fanout_ring, JohnFanoutReader *reader);
+void john_fanout_ring_get_reader_stats(JohnFanoutRing *fanout_ring, JohnFanoutReader *reader,
+                                       JohnFanoutReaderStats *stats);
+uint32_t john_fanout_ring_reader_count(JohnFanoutRing *fanout_ring);
+/* releases every frame, readers wait for the next key frame (e.g. after the encoder restarted) */
+void john_fanout_ring_clear(JohnFanoutRing *fanout_ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JOHN_FANOUT_RING_H__ */
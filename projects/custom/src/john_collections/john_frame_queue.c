@@ -0,0 +1,243 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Note: We did not check if the pthread related function call succeeded
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#include <pthread.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <time.h>
+#include "john_frame_queue.h"
+
+typedef struct JohnFrameEntry {
+    void *data;
+    uint32_t size;
+    JohnFramePriority priority;
+} JohnFrameEntry;
+
+struct JohnFrameQueue {
+    JohnFrameEntry *entries; /* circular, entry i lives at (head + i) % capacity */
+    uint32_t capacity;
+    uint32_t head;
+    uint32_t size;
+    bool waiting_for_key; /* a reference frame was dropped, its dependents must go too */
+    JohnFrameQueueStats stats;
+
+    void *return_on_empty;
+    void *user_client_params;
+    void (*drop_func)(void *data, void *user_client_params);
+
+    pthread_mutex_t lock;
+    pthread_cond_t empty_condition;
+};
+
+static inline JohnFrameEntry *john_frame_queue_at(JohnFrameQueue *frame_queue, uint32_t index) {
+    return &frame_queue->entries[(frame_queue->head + index) % frame_queue->capacity];
+}
+
+/* must hold lock */
+static void john_frame_queue_drop(JohnFrameQueue *frame_queue, JohnFrameEntry *entry) {
+    ++frame_queue->stats.dropped_frames;
+    frame_queue->stats.dropped_bytes += entry->size;
+    switch (entry->priority) {
+        case JOHN_FRAME_NON_REFERENCE:
+            ++frame_queue->stats.dropped_non_reference;
+            break;
+        case JOHN_FRAME_REFERENCE:
+            ++frame_queue->stats.dropped_reference;
+            break;
+        default:
+            ++frame_queue->stats.dropped_key;
+            break;
+    }
+    if (frame_queue->drop_func) {
+        frame_queue->drop_func(entry->data, frame_queue->user_client_params);
+    }
+}
+
+/* must hold lock; drops entries [from, to) and closes the gap */
+static void john_frame_queue_remove(JohnFrameQueue *frame_queue, uint32_t from, uint32_t to) {
+    uint32_t count = to - from;
+    for (uint32_t i = from; i < to; ++i) {
+        john_frame_queue_drop(frame_queue, john_frame_queue_at(frame_queue, i));
+    }
+    if (from == 0) {
+        frame_queue->head = (frame_queue->head + count) % frame_queue->capacity;
+    } else {
+        for (uint32_t i = to; i < frame_queue->size; ++i) {
+            *john_frame_queue_at(frame_queue, i - count) = *john_frame_queue_at(frame_queue, i);
+        }
+    }
+    frame_queue->size -= count;
+}
+
+/* must hold lock; returns whether the incoming frame has room now */
+static bool john_frame_queue_make_room(JohnFrameQueue *frame_queue, JohnFramePriority priority) {
+    uint32_t i;
+    for (i = 0; i < frame_queue->size; ++i) {
+        if (john_frame_queue_at(frame_queue, i)->priority == JOHN_FRAME_NON_REFERENCE) {
+            john_frame_queue_remove(frame_queue, i, i + 1);
+            return true;
+        }
+    }
+    for (i = 1; i < frame_queue->size; ++i) {
+        if (john_frame_queue_at(frame_queue, i)->priority == JOHN_FRAME_KEY) {
+            john_frame_queue_remove(frame_queue, 0, i);
+            return true;
+        }
+    }
+    if (priority == JOHN_FRAME_KEY) {
+        john_frame_queue_remove(frame_queue, 0, frame_queue->size);
+        return true;
+    }
+    return false;
+}
+
+JohnFrameQueue *john_frame_queue_create(uint32_t capacity, void *return_on_empty,
+                                        void (*drop_func)(void *data, void *user_client_params),
+                                        void *user_client_params) {
+    if (capacity == 0) {
+        return NULL;
+    }
+    JohnFrameQueue *frame_queue = (JohnFrameQueue *) malloc(sizeof(JohnFrameQueue));
+    if (frame_queue) {
+        memset(frame_queue, 0, sizeof(JohnFrameQueue));
+        frame_queue->entries = (JohnFrameEntry *) malloc(sizeof(JohnFrameEntry) * capacity);
+        if (!frame_queue->entries) {
+            free(frame_queue);
+            return NULL;
+        }
+        frame_queue->capacity = capacity;
+        frame_queue->return_on_empty = return_on_empty;
+        frame_queue->drop_func = drop_func;
+        frame_queue->user_client_params = user_client_params;
+
+        pthread_mutex_init(&frame_queue->lock, NULL);
+        pthread_cond_init(&frame_queue->empty_condition, NULL);
+    }
+    return frame_queue;
+}
+
+void john_frame_queue_destroy(JohnFrameQueue *frame_queue) {
+    if (frame_queue) {
+        john_frame_queue_clear(frame_queue);
+
+        pthread_cond_destroy(&frame_queue->empty_condition);
+        memset(&frame_queue->empty_condition, 0, sizeof(pthread_cond_t));
+        pthread_mutex_destroy(&frame_queue->lock);
+        memset(&frame_queue->lock, 0, sizeof(pthread_mutex_t));
+
+        free(frame_queue->entries);
+        frame_queue->entries = NULL;
+        free(frame_queue);
+    }
+}
+
+bool john_frame_queue_enqueue(JohnFrameQueue *frame_queue, void *data, uint32_t size, JohnFramePriority priority) {
+    bool result = false;
+    if (!frame_queue || !data) {
+        return result;
+    }
+    JohnFrameEntry entry = { data, size, priority };
+    pthread_mutex_lock(&frame_queue->lock);
+    if (priority == JOHN_FRAME_KEY) {
+        frame_queue->waiting_for_key = false;
+    }
+    if (!frame_queue->waiting_for_key &&
+        (frame_queue->size < frame_queue->capacity || john_frame_queue_make_room(frame_queue, priority))) {
+        *john_frame_queue_at(frame_queue, frame_queue->size++) = entry;
+        pthread_cond_signal(&frame_queue->empty_condition);
+        result = true;
+    } else {
+        if (priority != JOHN_FRAME_NON_REFERENCE) {
+            frame_queue->waiting_for_key = true;
+        }
+        john_frame_queue_drop(frame_queue, &entry);
+    }
+    pthread_mutex_unlock(&frame_queue->lock);
+    return result;
+}
+
+void *john_frame_queue_dequeue(JohnFrameQueue *frame_queue, int32_t timeout_millis) {
+    void *result = NULL;
+    if (!frame_queue) {
+        return result;
+    }
+    result = frame_queue->return_on_empty;
+    pthread_mutex_lock(&frame_queue->lock);
+    if (frame_queue->size == 0 && timeout_millis < 0) {
+        while (frame_queue->size == 0) {
+            pthread_cond_wait(&frame_queue->empty_condition, &frame_queue->lock);
+        }
+    } else if (frame_queue->size == 0 && timeout_millis > 0) {
+        int rc = 0;
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        now.tv_sec += timeout_millis / 1000;
+        now.tv_nsec += (timeout_millis % 1000) * 1000000;
+        if (now.tv_nsec >= 1000000000) {
+            ++now.tv_sec;
+            now.tv_nsec -= 1000000000;
+        }
+        while (frame_queue->size == 0 && rc != ETIMEDOUT) {
+            rc = pthread_cond_timedwait(&frame_queue->empty_condition, &frame_queue->lock, &now);
+        }
+    }
+    if (frame_queue->size > 0) {
+        result = john_frame_queue_at(frame_queue, 0)->data;
+        frame_queue->head = (frame_queue->head + 1) % frame_queue->capacity;
+        --frame_queue->size;
+    }
+    pthread_mutex_unlock(&frame_queue->lock);
+    return result;
+}
+
+uint32_t john_frame_queue_size(JohnFrameQueue *frame_queue) {
+    uint32_t result = 0;
+    if (frame_queue) {
+        pthread_mutex_lock(&frame_queue->lock);
+        result = frame_queue->size;
+        pthread_mutex_unlock(&frame_queue->lock);
+    }
+    return result;
+}
+
+void john_frame_queue_get_stats(JohnFrameQueue *frame_queue, JohnFrameQueueStats *stats) {
+    if (frame_queue && stats) {
+        pthread_mutex_lock(&frame_queue->lock);
+        *stats = frame_queue->stats;
+        pthread_mutex_unlock(&frame_queue->lock);
+    }
+}
+
+void john_frame_queue_clear(JohnFrameQueue *frame_queue) {
+    if (frame_queue) {
+        pthread_mutex_lock(&frame_queue->lock);
+        while (frame_queue->size > 0) {
+            JohnFrameEntry *entry = john_frame_queue_at(frame_queue, 0);
+            if (frame_queue->drop_func) {
+                frame_queue->drop_func(entry->data, frame_queue->user_client_params);
+            }
+            frame_queue->head = (frame_queue->head + 1) % frame_queue->capacity;
+            --frame_queue->size;
+        }
+        pthread_mutex_unlock(&frame_queue->lock);
+    }
+}
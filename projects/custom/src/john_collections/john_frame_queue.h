@@ -0,0 +1,72 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Bounded synchronized queue for encoded video frames tagged with their reference priority.
+ * On overflow it never blocks the producer, instead it drops in this order:
+ * 1. the oldest non-reference frame;
+ * 2. the oldest whole GOP (key frame plus the frames depending on it) when a newer key frame is queued;
+ * 3. everything queued when the incoming frame is itself a key frame;
+ * 4. otherwise the incoming frame, and every following frame until the next key frame,
+ *    since they all depend on the frame that could not be queued.
+ * The queue owns every enqueued element, dropped elements are handed to drop_func.
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#ifndef __JOHN_FRAME_QUEUE_H__
+#define __JOHN_FRAME_QUEUE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum JohnFramePriority {
+    JOHN_FRAME_NON_REFERENCE = 0, /* nothing depends on it, e.g. non-reference B frame */
+    JOHN_FRAME_REFERENCE = 1,     /* later frames up to the next key frame may depend on it */
+    JOHN_FRAME_KEY = 2,           /* IDR, starts a new GOP */
+} JohnFramePriority;
+
+typedef struct JohnFrameQueueStats {
+    uint64_t dropped_frames;
+    uint64_t dropped_bytes;
+    uint64_t dropped_non_reference;
+    uint64_t dropped_reference;
+    uint64_t dropped_key;
+} JohnFrameQueueStats;
+
+typedef struct JohnFrameQueue JohnFrameQueue;
+
+JohnFrameQueue *john_frame_queue_create(uint32_t capacity, void *return_on_empty,
+                                        void (*drop_func)(void *data, void *user_client_params),
+                                        void *user_client_params);
+/* remaining elements are handed to drop_func */
+void john_frame_queue_destroy(JohnFrameQueue *frame_queue);
+/* never blocks, returns false if the frame itself was dropped */
+bool john_frame_queue_enqueue(JohnFrameQueue *frame_queue, void *data, uint32_t size, JohnFramePriority priority);
+void *john_frame_queue_dequeue(JohnFrameQueue *frame_queue, int32_t timeout_millis);
+uint32_t john_frame_queue_size(JohnFrameQueue *frame_queue);
+void john_frame_queue_get_stats(JohnFrameQueue *frame_queue, JohnFrameQueueStats *stats);
+/* elements are handed to drop_func, but not counted as dropped */
+void john_frame_queue_clear(JohnFrameQueue *frame_queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JOHN_FRAME_QUEUE_H__ */
@@ -0,0 +1,320 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Every cell carries a sequence number: sequence == position means the cell is free for the
+ * producer claiming that position, sequence == position + 1 means it holds data for the consumer
+ * claiming that position. Producers and consumers claim positions with a CAS on their own counter.
+ * Threads only take the mutex to park when the queue is full/empty, and are woken only if parked.
+ * Note: We did not check if the pthread related function call succeeded
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#include <pthread.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <memory.h>
+#include <time.h>
+#include "john_mpmc_queue.h"
+
+#define JOHN_CACHE_LINE_SIZE 64
+#define JOHN_MPMC_QUEUE_REPLACE_RETRY 4
+
+typedef struct JohnMpmcQueueCell {
+    atomic_uint sequence;
+    _Atomic(void *) data;
+} JohnMpmcQueueCell;
+
+struct JohnMpmcQueue {
+    atomic_uint enqueue_position;
+    char enqueue_padding[JOHN_CACHE_LINE_SIZE - sizeof(atomic_uint)];
+    atomic_uint dequeue_position;
+    char dequeue_padding[JOHN_CACHE_LINE_SIZE - sizeof(atomic_uint)];
+    atomic_int empty_waiters;
+    atomic_int full_waiters;
+    char waiters_padding[JOHN_CACHE_LINE_SIZE - 2 * sizeof(atomic_int)];
+
+    JohnMpmcQueueCell *cells;
+    uint32_t capacity;
+    uint32_t mask;
+    bool replace_oldest;
+    void *return_on_empty;
+
+    pthread_mutex_t lock;
+    pthread_cond_t empty_condition;
+    pthread_cond_t full_condition;
+};
+
+static bool john_mpmc_queue_try_enqueue(JohnMpmcQueue *mpmc_queue, void *data) {
+    JohnMpmcQueueCell *cell;
+    uint32_t position = atomic_load_explicit(&mpmc_queue->enqueue_position, memory_order_relaxed);
+    while (true) {
+        cell = &mpmc_queue->cells[position & mpmc_queue->mask];
+        uint32_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        int32_t diff = (int32_t) (sequence - position);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&mpmc_queue->enqueue_position, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) { /* is full */
+            return false;
+        } else {
+            position = atomic_load_explicit(&mpmc_queue->enqueue_position, memory_order_relaxed);
+        }
+    }
+    atomic_store_explicit(&cell->data, data, memory_order_relaxed);
+    atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+    return true;
+}
+
+static bool john_mpmc_queue_try_dequeue(JohnMpmcQueue *mpmc_queue, void **data) {
+    JohnMpmcQueueCell *cell;
+    uint32_t position = atomic_load_explicit(&mpmc_queue->dequeue_position, memory_order_relaxed);
+    while (true) {
+        cell = &mpmc_queue->cells[position & mpmc_queue->mask];
+        uint32_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        int32_t diff = (int32_t) (sequence - (position + 1));
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&mpmc_queue->dequeue_position, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) { /* is empty */
+            return false;
+        } else {
+            position = atomic_load_explicit(&mpmc_queue->dequeue_position, memory_order_relaxed);
+        }
+    }
+    *data = atomic_load_explicit(&cell->data, memory_order_relaxed);
+    atomic_store_explicit(&cell->sequence, position + mpmc_queue->mask + 1, memory_order_release);
+    return true;
+}
+
+/* the fence pairs with the one a parking thread issues after announcing itself in waiters */
+static inline void john_mpmc_queue_wake(JohnMpmcQueue *mpmc_queue, atomic_int *waiters, pthread_cond_t *condition) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(waiters, memory_order_relaxed) > 0) {
+        pthread_mutex_lock(&mpmc_queue->lock);
+        pthread_cond_signal(condition);
+        pthread_mutex_unlock(&mpmc_queue->lock);
+    }
+}
+
+static inline void john_mpmc_queue_deadline(struct timespec *deadline, int32_t timeout_millis) {
+    clock_gettime(CLOCK_REALTIME, deadline);
+    deadline->tv_sec += timeout_millis / 1000;
+    deadline->tv_nsec += (timeout_millis % 1000) * 1000000;
+    if (deadline->tv_nsec >= 1000000000) {
+        ++deadline->tv_sec;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+JohnMpmcQueue *john_mpmc_queue_create(uint32_t capacity, bool replace_oldest, void *return_on_empty) {
+    if (capacity == 0 || capacity > (1U << 30)) {
+        return NULL;
+    }
+    uint32_t power_of_two = 2;
+    while (power_of_two < capacity) {
+        power_of_two <<= 1;
+    }
+
+    JohnMpmcQueue *mpmc_queue = (JohnMpmcQueue *) malloc(sizeof(JohnMpmcQueue));
+    if (mpmc_queue) {
+        memset(mpmc_queue, 0, sizeof(JohnMpmcQueue));
+        mpmc_queue->cells = (JohnMpmcQueueCell *) malloc(sizeof(JohnMpmcQueueCell) * power_of_two);
+        if (!mpmc_queue->cells) {
+            free(mpmc_queue);
+            return NULL;
+        }
+        for (uint32_t i = 0; i < power_of_two; ++i) {
+            atomic_init(&mpmc_queue->cells[i].sequence, i);
+            atomic_init(&mpmc_queue->cells[i].data, NULL);
+        }
+        mpmc_queue->capacity = power_of_two;
+        mpmc_queue->mask = power_of_two - 1;
+        mpmc_queue->replace_oldest = replace_oldest;
+        mpmc_queue->return_on_empty = return_on_empty;
+        atomic_init(&mpmc_queue->enqueue_position, 0);
+        atomic_init(&mpmc_queue->dequeue_position, 0);
+        atomic_init(&mpmc_queue->empty_waiters, 0);
+        atomic_init(&mpmc_queue->full_waiters, 0);
+
+        pthread_mutex_init(&mpmc_queue->lock, NULL);
+        pthread_cond_init(&mpmc_queue->empty_condition, NULL);
+        pthread_cond_init(&mpmc_queue->full_condition, NULL);
+    }
+    return mpmc_queue;
+}
+
+void john_mpmc_queue_destroy(JohnMpmcQueue *mpmc_queue) {
+    if (mpmc_queue) {
+        pthread_cond_destroy(&mpmc_queue->empty_condition);
+        memset(&mpmc_queue->empty_condition, 0, sizeof(pthread_cond_t));
+        pthread_cond_destroy(&mpmc_queue->full_condition);
+        memset(&mpmc_queue->full_condition, 0, sizeof(pthread_cond_t));
+        pthread_mutex_destroy(&mpmc_queue->lock);
+        memset(&mpmc_queue->lock, 0, sizeof(pthread_mutex_t));
+
+        free(mpmc_queue->cells);
+        mpmc_queue->cells = NULL;
+        free(mpmc_queue);
+    }
+}
+
+bool john_mpmc_queue_enqueue(JohnMpmcQueue *mpmc_queue, void *data, int32_t timeout_millis) {
+    bool result = false;
+    if (!mpmc_queue || !data) {
+        return result;
+    }
+    if (john_mpmc_queue_try_enqueue(mpmc_queue, data)) {
+        goto success;
+    } else if (timeout_millis != 0) {
+        int rc = 0;
+        struct timespec deadline;
+        if (timeout_millis > 0) {
+            john_mpmc_queue_deadline(&deadline, timeout_millis);
+        }
+        pthread_mutex_lock(&mpmc_queue->lock);
+        atomic_fetch_add(&mpmc_queue->full_waiters, 1);
+        while (true) {
+            atomic_thread_fence(memory_order_seq_cst);
+            if ((result = john_mpmc_queue_try_enqueue(mpmc_queue, data)) || rc == ETIMEDOUT) {
+                break;
+            }
+            if (timeout_millis < 0) {
+                pthread_cond_wait(&mpmc_queue->full_condition, &mpmc_queue->lock);
+            } else {
+                rc = pthread_cond_timedwait(&mpmc_queue->full_condition, &mpmc_queue->lock, &deadline);
+            }
+        }
+        atomic_fetch_sub(&mpmc_queue->full_waiters, 1);
+        pthread_mutex_unlock(&mpmc_queue->lock);
+        if (result) {
+            goto success;
+        }
+    }
+    /* check: */
+    if (mpmc_queue->replace_oldest) {
+        void *older;
+        for (int i = 0; i < JOHN_MPMC_QUEUE_REPLACE_RETRY; ++i) {
+            john_mpmc_queue_try_dequeue(mpmc_queue, &older);
+            if (john_mpmc_queue_try_enqueue(mpmc_queue, data)) {
+                goto success;
+            }
+        }
+    }
+    return false;
+    success:
+    john_mpmc_queue_wake(mpmc_queue, &mpmc_queue->empty_waiters, &mpmc_queue->empty_condition);
+    return true;
+}
+
+void *john_mpmc_queue_dequeue(JohnMpmcQueue *mpmc_queue, int32_t timeout_millis) {
+    void *result = NULL;
+    if (!mpmc_queue) {
+        return result;
+    }
+    if (john_mpmc_queue_try_dequeue(mpmc_queue, &result)) {
+        goto success;
+    } else if (timeout_millis != 0) {
+        bool dequeued = false;
+        int rc = 0;
+        struct timespec deadline;
+        if (timeout_millis > 0) {
+            john_mpmc_queue_deadline(&deadline, timeout_millis);
+        }
+        pthread_mutex_lock(&mpmc_queue->lock);
+        atomic_fetch_add(&mpmc_queue->empty_waiters, 1);
+        while (true) {
+            atomic_thread_fence(memory_order_seq_cst);
+            if ((dequeued = john_mpmc_queue_try_dequeue(mpmc_queue, &result)) || rc == ETIMEDOUT) {
+                break;
+            }
+            if (timeout_millis < 0) {
+                pthread_cond_wait(&mpmc_queue->empty_condition, &mpmc_queue->lock);
+            } else {
+                rc = pthread_cond_timedwait(&mpmc_queue->empty_condition, &mpmc_queue->lock, &deadline);
+            }
+        }
+        atomic_fetch_sub(&mpmc_queue->empty_waiters, 1);
+        pthread_mutex_unlock(&mpmc_queue->lock);
+        if (dequeued) {
+            goto success;
+        }
+    }
+    return mpmc_queue->return_on_empty;
+    success:
+    john_mpmc_queue_wake(mpmc_queue, &mpmc_queue->full_waiters, &mpmc_queue->full_condition);
+    return result;
+}
+
+void *john_mpmc_queue_head(JohnMpmcQueue *mpmc_queue) {
+    void *result = NULL;
+    if (mpmc_queue) {
+        result = mpmc_queue->return_on_empty;
+        uint32_t position = atomic_load_explicit(&mpmc_queue->dequeue_position, memory_order_relaxed);
+        JohnMpmcQueueCell *cell = &mpmc_queue->cells[position & mpmc_queue->mask];
+        if (atomic_load_explicit(&cell->sequence, memory_order_acquire) == position + 1) {
+            result = atomic_load_explicit(&cell->data, memory_order_relaxed);
+        }
+    }
+    return result;
+}
+
+void *john_mpmc_queue_tail(JohnMpmcQueue *mpmc_queue) {
+    void *result = NULL;
+    if (mpmc_queue) {
+        result = mpmc_queue->return_on_empty;
+        uint32_t position = atomic_load_explicit(&mpmc_queue->enqueue_position, memory_order_relaxed) - 1;
+        JohnMpmcQueueCell *cell = &mpmc_queue->cells[position & mpmc_queue->mask];
+        if (atomic_load_explicit(&cell->sequence, memory_order_acquire) == position + 1) {
+            result = atomic_load_explicit(&cell->data, memory_order_relaxed);
+        }
+    }
+    return result;
+}
+
+bool john_mpmc_queue_is_full(JohnMpmcQueue *mpmc_queue) {
+    bool result = false;
+    if (mpmc_queue) {
+        uint32_t dequeue_position = atomic_load_explicit(&mpmc_queue->dequeue_position, memory_order_relaxed);
+        uint32_t enqueue_position = atomic_load_explicit(&mpmc_queue->enqueue_position, memory_order_relaxed);
+        result = (int32_t) (enqueue_position - dequeue_position) >= (int32_t) mpmc_queue->capacity;
+    }
+    return result;
+}
+
+bool john_mpmc_queue_is_empty(JohnMpmcQueue *mpmc_queue) {
+    bool result = false;
+    if (mpmc_queue) {
+        uint32_t dequeue_position = atomic_load_explicit(&mpmc_queue->dequeue_position, memory_order_relaxed);
+        uint32_t enqueue_position = atomic_load_explicit(&mpmc_queue->enqueue_position, memory_order_relaxed);
+        result = (int32_t) (enqueue_position - dequeue_position) <= 0;
+    }
+    return result;
+}
+
+void john_mpmc_queue_clear(JohnMpmcQueue *mpmc_queue) {
+    if (mpmc_queue) {
+        void *data;
+        while (john_mpmc_queue_try_dequeue(mpmc_queue, &data)) {
+            john_mpmc_queue_wake(mpmc_queue, &mpmc_queue->full_waiters, &mpmc_queue->full_condition);
+        }
+    }
+}
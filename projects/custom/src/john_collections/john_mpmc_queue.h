@@ -0,0 +1,50 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Bounded lock-free multi-producer/multi-consumer queue (per-slot sequence numbers).
+ * Same create/timeout contract as john_synchronized_queue, capacity is rounded up to a power of two.
+ * head/tail/is_full/is_empty are lock-free snapshots and may be stale under concurrent use.
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#ifndef __JOHN_MPMC_QUEUE_H__
+#define __JOHN_MPMC_QUEUE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct JohnMpmcQueue JohnMpmcQueue;
+
+JohnMpmcQueue *john_mpmc_queue_create(uint32_t capacity, bool replace_oldest, void *return_on_empty);
+void john_mpmc_queue_destroy(JohnMpmcQueue *mpmc_queue);
+bool john_mpmc_queue_enqueue(JohnMpmcQueue *mpmc_queue, void *data, int32_t timeout_millis);
+void *john_mpmc_queue_dequeue(JohnMpmcQueue *mpmc_queue, int32_t timeout_millis);
+void *john_mpmc_queue_head(JohnMpmcQueue *mpmc_queue);
+void *john_mpmc_queue_tail(JohnMpmcQueue *mpmc_queue);
+bool john_mpmc_queue_is_full(JohnMpmcQueue *mpmc_queue);
+bool john_mpmc_queue_is_empty(JohnMpmcQueue *mpmc_queue);
+void john_mpmc_queue_clear(JohnMpmcQueue *mpmc_queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JOHN_MPMC_QUEUE_H__ */
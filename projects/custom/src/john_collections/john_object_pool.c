@@ -15,6 +15,11 @@
  * limitations under the license.
  */
 /**
+ * Every thread owns a small magazine (a private stack) per pool, kept in a pthread key.
+ * obtain/recycle only touch that magazine; the pool lock is taken once per batch when a
+ * magazine needs a refill from, or a spill to, the shared JohnStack.
+ * The magazines of other threads are never touched while their owners run, so an obtain at
+ * max_size fails even when other threads cache idle objects, see john_object_pool_obtain.
  * Note: We did not check if the pthread related function call succeeded
  * @author John Kenrinus Lee
  * @version 2017-11-10
@@ -25,13 +30,27 @@
 #include "john_stack.h"
 #include "john_object_pool.h"
 
+#define JOHN_OBJECT_POOL_MAGAZINE_CAPACITY 16
+
+typedef struct JohnObjectPoolMagazine {
+    JohnObjectPool *object_pool;
+    uint32_t size;
+    void *objects[JOHN_OBJECT_POOL_MAGAZINE_CAPACITY];
+    struct JohnObjectPoolMagazine *prev;
+    struct JohnObjectPoolMagazine *next;
+} JohnObjectPoolMagazine;
+
 struct JohnObjectPool {
     uint32_t max_size;
     uint32_t pool_size;
     uint32_t prepare_size;
     uint32_t alloc_size;
+    uint32_t magazine_capacity;
+    uint32_t magazine_batch;
 
     JohnStack *stack;
+    pthread_key_t magazine_key;
+    JohnObjectPoolMagazine *magazines; /* every thread's magazine, to release them on destroy */
 
     void *user_client_params;
     void *(*create_func)(void *user_client_params);
@@ -41,20 +60,62 @@ struct JohnObjectPool {
     pthread_mutex_t lock;
 };
 
-static inline bool john_object_pool_is_empty(JohnObjectPool *object_pool) {
-    bool result;
-    pthread_mutex_lock(&object_pool->lock);
-    result = john_stack_is_empty(object_pool->stack);
-    pthread_mutex_unlock(&object_pool->lock);
-    return result;
+/* must hold lock */
+static inline void john_object_pool_release_object(JohnObjectPool *object_pool, void *object) {
+    --object_pool->alloc_size;
+    if (object_pool->destroy_func) {
+        object_pool->destroy_func(object, object_pool->user_client_params);
+    } else {
+        free(object);
+    }
 }
 
-static inline bool john_object_pool_is_full(JohnObjectPool *object_pool) {
-    bool result;
+/* must hold lock; keeps the newest 'keep' objects in magazine */
+static void john_object_pool_spill(JohnObjectPool *object_pool, JohnObjectPoolMagazine *magazine, uint32_t keep) {
+    while (magazine->size > keep) {
+        void *object = magazine->objects[--magazine->size];
+        if (!john_stack_push(object_pool->stack, object)) { /* shared stack is full */
+            john_object_pool_release_object(object_pool, object);
+        }
+    }
+}
+
+/* called by pthread when a thread that used the pool exits */
+static void john_object_pool_magazine_destructor(void *value) {
+    JohnObjectPoolMagazine *magazine = (JohnObjectPoolMagazine *) value;
+    JohnObjectPool *object_pool = magazine->object_pool;
     pthread_mutex_lock(&object_pool->lock);
-    result = john_stack_is_full(object_pool->stack);
+    john_object_pool_spill(object_pool, magazine, 0);
+    if (magazine->prev) {
+        magazine->prev->next = magazine->next;
+    } else {
+        object_pool->magazines = magazine->next;
+    }
+    if (magazine->next) {
+        magazine->next->prev = magazine->prev;
+    }
     pthread_mutex_unlock(&object_pool->lock);
-    return result;
+    free(magazine);
+}
+
+static inline JohnObjectPoolMagazine *john_object_pool_magazine(JohnObjectPool *object_pool) {
+    JohnObjectPoolMagazine *magazine = (JohnObjectPoolMagazine *) pthread_getspecific(object_pool->magazine_key);
+    if (!magazine) {
+        magazine = (JohnObjectPoolMagazine *) malloc(sizeof(JohnObjectPoolMagazine));
+        if (magazine) {
+            memset(magazine, 0, sizeof(JohnObjectPoolMagazine));
+            magazine->object_pool = object_pool;
+            pthread_mutex_lock(&object_pool->lock);
+            magazine->next = object_pool->magazines;
+            if (magazine->next) {
+                magazine->next->prev = magazine;
+            }
+            object_pool->magazines = magazine;
+            pthread_mutex_unlock(&object_pool->lock);
+            pthread_setspecific(object_pool->magazine_key, magazine);
+        }
+    }
+    return magazine;
 }
 
 JohnObjectPool *john_object_pool_create(uint32_t max_size, uint32_t pool_size, uint32_t prepare_size,
@@ -70,6 +131,15 @@ JohnObjectPool *john_object_pool_create(uint32_t max_size, uint32_t pool_size, u
         object_pool->pool_size = pool_size;
         object_pool->prepare_size = prepare_size;
 
+        /* small pools get small magazines, so one thread can not hoard the whole pool */
+        object_pool->magazine_capacity = pool_size / 4;
+        if (object_pool->magazine_capacity > JOHN_OBJECT_POOL_MAGAZINE_CAPACITY) {
+            object_pool->magazine_capacity = JOHN_OBJECT_POOL_MAGAZINE_CAPACITY;
+        } else if (object_pool->magazine_capacity < 1) {
+            object_pool->magazine_capacity = 1;
+        }
+        object_pool->magazine_batch = (object_pool->magazine_capacity + 1) / 2;
+
         object_pool->stack = john_stack_create(pool_size);
 
         object_pool->user_client_params = delegate->user_client_params;
@@ -77,6 +147,7 @@ JohnObjectPool *john_object_pool_create(uint32_t max_size, uint32_t pool_size, u
         object_pool->destroy_func = delegate->destroy_func;
         object_pool->reset_func = delegate->reset_func;
 
+        pthread_key_create(&object_pool->magazine_key, john_object_pool_magazine_destructor);
         pthread_mutex_init(&object_pool->lock, NULL);
 
         pthread_mutex_lock(&object_pool->lock);
@@ -90,8 +161,29 @@ JohnObjectPool *john_object_pool_create(uint32_t max_size, uint32_t pool_size, u
     return object_pool;
 }
 
+/* User should make sure no other thread still uses the pool */
 void john_object_pool_destroy(JohnObjectPool *object_pool) {
     if (object_pool) {
+        pthread_setspecific(object_pool->magazine_key, NULL);
+        pthread_key_delete(object_pool->magazine_key);
+
+        pthread_mutex_lock(&object_pool->lock);
+        JohnObjectPoolMagazine *magazine = object_pool->magazines;
+        while (magazine) {
+            JohnObjectPoolMagazine *next = magazine->next;
+            while (magazine->size > 0) {
+                john_object_pool_release_object(object_pool, magazine->objects[--magazine->size]);
+            }
+            free(magazine);
+            magazine = next;
+        }
+        object_pool->magazines = NULL;
+        void *object;
+        while ((object = john_stack_pop(object_pool->stack))) {
+            john_object_pool_release_object(object_pool, object);
+        }
+        pthread_mutex_unlock(&object_pool->lock);
+
         object_pool->user_client_params = NULL;
         pthread_mutex_destroy(&object_pool->lock);
         memset(&object_pool->lock, 0, sizeof(pthread_mutex_t));
@@ -103,14 +195,26 @@ void john_object_pool_destroy(JohnObjectPool *object_pool) {
 
 void *john_object_pool_obtain(JohnObjectPool *object_pool) {
     if (object_pool) {
-        void *object;
+        void *object = NULL;
+        JohnObjectPoolMagazine *magazine = john_object_pool_magazine(object_pool);
+        if (magazine && magazine->size > 0) { /* fast path, no lock */
+            return magazine->objects[--magazine->size];
+        }
         pthread_mutex_lock(&object_pool->lock);
-        if (john_object_pool_is_empty(object_pool) && object_pool->alloc_size < object_pool->max_size) {
-            object = object_pool->create_func(object_pool->user_client_params);
-            ++object_pool->alloc_size;
+        if (magazine) { /* refill a batch at once */
+            while (magazine->size < object_pool->magazine_batch && !john_stack_is_empty(object_pool->stack)) {
+                magazine->objects[magazine->size++] = john_stack_pop(object_pool->stack);
+            }
+            if (magazine->size > 0) {
+                object = magazine->objects[--magazine->size];
+            }
         } else {
             object = john_stack_pop(object_pool->stack);
         }
+        if (!object && object_pool->alloc_size < object_pool->max_size) {
+            object = object_pool->create_func(object_pool->user_client_params);
+            ++object_pool->alloc_size;
+        }
         pthread_mutex_unlock(&object_pool->lock);
         return object;
     }
@@ -120,14 +224,32 @@ void *john_object_pool_obtain(JohnObjectPool *object_pool) {
 /* User should avoid recycle repeatedly and avoid recycle object which had free */
 void john_object_pool_recycle(JohnObjectPool *object_pool, void *object) {
     if (object_pool && object) {
-        pthread_mutex_lock(&object_pool->lock);
-        if (!john_object_pool_is_full(object_pool)) {
+        if (object_pool->reset_func) {
             object_pool->reset_func(object, object_pool->user_client_params);
-            john_stack_push(object_pool->stack, object);
+        }
+        JohnObjectPoolMagazine *magazine = john_object_pool_magazine(object_pool);
+        if (magazine && magazine->size < object_pool->magazine_capacity) { /* fast path, no lock */
+            magazine->objects[magazine->size++] = object;
             return;
         }
-        --object_pool->alloc_size;
+        pthread_mutex_lock(&object_pool->lock);
+        if (magazine) { /* spill a batch at once */
+            john_object_pool_spill(object_pool, magazine, object_pool->magazine_capacity - object_pool->magazine_batch);
+            magazine->objects[magazine->size++] = object;
+        } else if (!john_stack_push(object_pool->stack, object)) {
+            john_object_pool_release_object(object_pool, object);
+        }
         pthread_mutex_unlock(&object_pool->lock);
-        free(object);
+    }
+}
+
+void john_object_pool_flush_thread_cache(JohnObjectPool *object_pool) {
+    if (object_pool) {
+        JohnObjectPoolMagazine *magazine = (JohnObjectPoolMagazine *) pthread_getspecific(object_pool->magazine_key);
+        if (magazine && magazine->size > 0) {
+            pthread_mutex_lock(&object_pool->lock);
+            john_object_pool_spill(object_pool, magazine, 0);
+            pthread_mutex_unlock(&object_pool->lock);
+        }
     }
 }
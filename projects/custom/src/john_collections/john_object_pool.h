@@ -41,8 +41,12 @@ typedef struct JohnObjectPool JohnObjectPool;
 JohnObjectPool *john_object_pool_create(uint32_t max_size, uint32_t pool_size, uint32_t prepare_size,
                                         JohnObjectDelegate *delegate);
 void john_object_pool_destroy(JohnObjectPool *object_pool);
+/* NULL once max_size objects are allocated and neither the shared pool nor the calling thread's magazine holds an
+ * idle one; objects cached by other threads stay theirs until they spill them, exit or flush their cache */
 void *john_object_pool_obtain(JohnObjectPool *object_pool);
 void john_object_pool_recycle(JohnObjectPool *object_pool, void *object);
+/* hand the calling thread's cached objects back to the shared pool (done automatically on thread exit) */
+void john_object_pool_flush_thread_cache(JohnObjectPool *object_pool);
 
 #ifdef __cplusplus
 }
@@ -121,3 +121,39 @@ void john_queue_clear(JohnQueue *queue) {
         }
     }
 }
+
+uint32_t john_queue_enqueue_n(JohnQueue *queue, void **data, uint32_t count) {
+    uint32_t result = 0;
+    if (queue && data) {
+        while (result < count && john_queue_enqueue(queue, data[result])) {
+            ++result;
+        }
+    }
+    return result;
+}
+
+uint32_t john_queue_dequeue_n(JohnQueue *queue, void **data, uint32_t max_count) {
+    uint32_t result = 0;
+    if (queue && data) {
+        while (result < max_count && !john_queue_is_empty(queue)) {
+            data[result++] = john_queue_dequeue(queue);
+        }
+    }
+    return result;
+}
+
+uint32_t john_queue_drain(JohnQueue *queue, void (*func)(void *data, void *user_client_params),
+                          void *user_client_params) {
+    uint32_t result = 0;
+    if (queue) {
+        void *data;
+        while (!john_queue_is_empty(queue)) {
+            data = john_queue_dequeue(queue);
+            if (func) {
+                func(data, user_client_params);
+            }
+            ++result;
+        }
+    }
+    return result;
+}
@@ -39,6 +39,12 @@ void *john_queue_tail(JohnQueue *queue);
 bool john_queue_is_full(JohnQueue *queue);
 bool john_queue_is_empty(JohnQueue *queue);
 void john_queue_clear(JohnQueue *queue);
+/* batch variants, return how many elements were moved */
+uint32_t john_queue_enqueue_n(JohnQueue *queue, void **data, uint32_t count);
+uint32_t john_queue_dequeue_n(JohnQueue *queue, void **data, uint32_t max_count);
+/* remove every element, handing each to func (e.g. to free it) */
+uint32_t john_queue_drain(JohnQueue *queue, void (*func)(void *data, void *user_client_params),
+                          void *user_client_params);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,163 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * A slab is one malloc block: JohnSliceHeader followed by the payload bytes.
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <memory.h>
+#include "john_object_pool.h"
+#include "john_slab_arena.h"
+
+#define JOHN_SLAB_ARENA_MAX_CLASSES 32
+#define JOHN_SLAB_ARENA_ALIGNMENT 64
+#define JOHN_SLAB_ARENA_OVERSIZE (-1)
+
+typedef struct JohnSlabClass {
+    JohnSlabArena *arena;
+    int32_t index;
+    uint32_t slice_size;
+    JohnObjectPool *object_pool;
+} JohnSlabClass;
+
+typedef struct JohnSliceHeader {
+    JohnSlice slice; /* must be first, JohnSlice * is cast back to JohnSliceHeader * */
+    atomic_uint reference_count;
+    JohnSlabArena *arena;
+    int32_t size_class;
+} JohnSliceHeader;
+
+struct JohnSlabArena {
+    uint32_t class_count;
+    JohnSlabClass classes[JOHN_SLAB_ARENA_MAX_CLASSES];
+};
+
+static const size_t john_slice_data_offset =
+        (sizeof(JohnSliceHeader) + JOHN_SLAB_ARENA_ALIGNMENT - 1) & ~((size_t) JOHN_SLAB_ARENA_ALIGNMENT - 1);
+
+static JohnSliceHeader *john_slice_header_create(JohnSlabArena *arena, int32_t size_class, uint32_t slice_size) {
+    JohnSliceHeader *header = (JohnSliceHeader *) malloc(john_slice_data_offset + slice_size);
+    if (header) {
+        memset(header, 0, sizeof(JohnSliceHeader));
+        header->slice.data = (uint8_t *) header + john_slice_data_offset;
+        header->slice.capacity = slice_size;
+        header->arena = arena;
+        header->size_class = size_class;
+        atomic_init(&header->reference_count, 0);
+    }
+    return header;
+}
+
+static void *john_slab_class_create_func(void *user_client_params) {
+    JohnSlabClass *slab_class = (JohnSlabClass *) user_client_params;
+    return john_slice_header_create(slab_class->arena, slab_class->index, slab_class->slice_size);
+}
+
+static void john_slab_class_destroy_func(void *object, void *user_client_params) {
+    free(object);
+}
+
+static void john_slab_class_reset_func(void *object, void *user_client_params) {
+    ((JohnSliceHeader *) object)->slice.size = 0;
+}
+
+JohnSlabArena *john_slab_arena_create(uint32_t min_slice_size, uint32_t max_slice_size, uint32_t slices_per_class) {
+    if (min_slice_size == 0 || min_slice_size > max_slice_size || max_slice_size > (1U << 30)) {
+        return NULL;
+    }
+    JohnSlabArena *arena = (JohnSlabArena *) malloc(sizeof(JohnSlabArena));
+    if (arena) {
+        memset(arena, 0, sizeof(JohnSlabArena));
+        JohnObjectDelegate delegate;
+        uint32_t slice_size = JOHN_SLAB_ARENA_ALIGNMENT;
+        while (slice_size < min_slice_size) {
+            slice_size <<= 1;
+        }
+        for (; arena->class_count < JOHN_SLAB_ARENA_MAX_CLASSES; slice_size <<= 1) {
+            JohnSlabClass *slab_class = &arena->classes[arena->class_count];
+            slab_class->arena = arena;
+            slab_class->index = arena->class_count;
+            slab_class->slice_size = slice_size;
+            delegate.user_client_params = slab_class;
+            delegate.create_func = john_slab_class_create_func;
+            delegate.destroy_func = john_slab_class_destroy_func;
+            delegate.reset_func = john_slab_class_reset_func;
+            slab_class->object_pool = john_object_pool_create(UINT32_MAX, slices_per_class, 0, &delegate);
+            ++arena->class_count;
+            if (slice_size >= max_slice_size) {
+                break;
+            }
+        }
+    }
+    return arena;
+}
+
+void john_slab_arena_destroy(JohnSlabArena *arena) {
+    if (arena) {
+        for (uint32_t i = 0; i < arena->class_count; ++i) {
+            john_object_pool_destroy(arena->classes[i].object_pool);
+            arena->classes[i].object_pool = NULL;
+        }
+        memset(arena, 0, sizeof(JohnSlabArena));
+        free(arena);
+    }
+}
+
+JohnSlice *john_slab_arena_alloc(JohnSlabArena *arena, uint32_t size) {
+    if (!arena) {
+        return NULL;
+    }
+    JohnSliceHeader *header = NULL;
+    for (uint32_t i = 0; i < arena->class_count; ++i) {
+        if (size <= arena->classes[i].slice_size) {
+            header = (JohnSliceHeader *) john_object_pool_obtain(arena->classes[i].object_pool);
+            break;
+        }
+    }
+    if (!header) { /* bigger than the biggest class */
+        header = john_slice_header_create(arena, JOHN_SLAB_ARENA_OVERSIZE, size);
+    }
+    if (header) {
+        header->slice.size = size;
+        atomic_store_explicit(&header->reference_count, 1, memory_order_relaxed);
+        return &header->slice;
+    }
+    return NULL;
+}
+
+JohnSlice *john_slice_retain(JohnSlice *slice) {
+    if (slice) {
+        atomic_fetch_add_explicit(&((JohnSliceHeader *) slice)->reference_count, 1, memory_order_relaxed);
+    }
+    return slice;
+}
+
+void john_slice_release(JohnSlice *slice) {
+    if (slice) {
+        JohnSliceHeader *header = (JohnSliceHeader *) slice;
+        if (atomic_fetch_sub_explicit(&header->reference_count, 1, memory_order_acq_rel) != 1) {
+            return;
+        }
+        if (header->size_class == JOHN_SLAB_ARENA_OVERSIZE) {
+            free(header);
+        } else {
+            john_object_pool_recycle(header->arena->classes[header->size_class].object_pool, header);
+        }
+    }
+}
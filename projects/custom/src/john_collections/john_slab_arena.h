@@ -0,0 +1,56 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Slab arena for variable sized payloads (e.g. encoded frames) handed between threads.
+ * Sizes are rounded up to a power-of-two size class, every class recycles its slabs through
+ * a JohnObjectPool. A slice is reference counted, the last john_slice_release gives it back.
+ * Requests larger than the biggest class fall back to plain malloc/free.
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#ifndef __JOHN_SLAB_ARENA_H__
+#define __JOHN_SLAB_ARENA_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct JohnSlice {
+    uint8_t *data;
+    uint32_t size;     /* bytes in use, set by alloc, may be changed by the writer */
+    uint32_t capacity; /* bytes available at data */
+} JohnSlice;
+
+typedef struct JohnSlabArena JohnSlabArena;
+
+/* slices_per_class: how many free slabs each size class keeps for reuse */
+JohnSlabArena *john_slab_arena_create(uint32_t min_slice_size, uint32_t max_slice_size, uint32_t slices_per_class);
+/* User should release every slice before destroy */
+void john_slab_arena_destroy(JohnSlabArena *arena);
+/* returned slice has reference count 1 */
+JohnSlice *john_slab_arena_alloc(JohnSlabArena *arena, uint32_t size);
+JohnSlice *john_slice_retain(JohnSlice *slice);
+void john_slice_release(JohnSlice *slice);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JOHN_SLAB_ARENA_H__ */
@@ -0,0 +1,205 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * read_index and write_index only ever grow (wrapping at 2^32), slot = index & mask.
+ * The writer evicts the oldest element by advancing read_index with a CAS, so the reader
+ * also claims its slot with a CAS; the loser of that race simply retries.
+ * The mutex/condition pair is touched only when the reader finds the ring empty.
+ * Note: We did not check if the pthread related function call succeeded
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <memory.h>
+#include <errno.h>
+#include <time.h>
+#include "john_spsc_ring_buffer.h"
+
+#define JOHN_CACHE_LINE_SIZE 64
+
+struct JohnSpscRingBuffer {
+    atomic_uint write_index; /* written by writer */
+    char write_padding[JOHN_CACHE_LINE_SIZE - sizeof(atomic_uint)];
+    atomic_uint read_index; /* written by reader, and by writer on overwrite */
+    char read_padding[JOHN_CACHE_LINE_SIZE - sizeof(atomic_uint)];
+    atomic_int waiting; /* reader is (about to be) parked on condition */
+    char waiting_padding[JOHN_CACHE_LINE_SIZE - sizeof(atomic_int)];
+
+    uint32_t capacity;
+    uint32_t mask;
+    void *return_on_empty;
+    _Atomic(void *) *array;
+
+    pthread_mutex_t lock;
+    pthread_cond_t condition;
+};
+
+static inline bool john_spsc_ring_buffer_try_read(JohnSpscRingBuffer *ring_buffer, void **data) {
+    uint32_t read_index = atomic_load_explicit(&ring_buffer->read_index, memory_order_acquire);
+    while (true) {
+        uint32_t write_index = atomic_load_explicit(&ring_buffer->write_index, memory_order_acquire);
+        if (read_index == write_index) { /* is empty */
+            return false;
+        }
+        void *result = atomic_load_explicit(&ring_buffer->array[read_index & ring_buffer->mask],
+                                            memory_order_relaxed);
+        /* fails only if the writer overwrote this slot meanwhile, read_index is reloaded then */
+        if (atomic_compare_exchange_weak_explicit(&ring_buffer->read_index, &read_index, read_index + 1,
+                                                  memory_order_acq_rel, memory_order_acquire)) {
+            *data = result;
+            return true;
+        }
+    }
+}
+
+JohnSpscRingBuffer *john_spsc_ring_buffer_create(uint32_t capacity, void *return_on_empty) {
+    if (capacity == 0 || capacity > (1U << 31)) {
+        return NULL;
+    }
+    uint32_t power_of_two = 1;
+    while (power_of_two < capacity) {
+        power_of_two <<= 1;
+    }
+
+    JohnSpscRingBuffer *ring_buffer = (JohnSpscRingBuffer *) malloc(sizeof(JohnSpscRingBuffer));
+    if (ring_buffer) {
+        memset(ring_buffer, 0, sizeof(JohnSpscRingBuffer));
+        ring_buffer->capacity = power_of_two;
+        ring_buffer->mask = power_of_two - 1;
+        ring_buffer->return_on_empty = return_on_empty;
+        ring_buffer->array = (_Atomic(void *) *) malloc(sizeof(_Atomic(void *)) * power_of_two);
+        if (!ring_buffer->array) {
+            free(ring_buffer);
+            return NULL;
+        }
+        for (uint32_t i = 0; i < power_of_two; ++i) {
+            atomic_init(&ring_buffer->array[i], NULL);
+        }
+        atomic_init(&ring_buffer->write_index, 0);
+        atomic_init(&ring_buffer->read_index, 0);
+        atomic_init(&ring_buffer->waiting, 0);
+
+        pthread_mutex_init(&ring_buffer->lock, NULL);
+        pthread_cond_init(&ring_buffer->condition, NULL);
+    }
+    return ring_buffer;
+}
+
+void john_spsc_ring_buffer_destroy(JohnSpscRingBuffer *ring_buffer) {
+    if (ring_buffer) {
+        pthread_cond_destroy(&ring_buffer->condition);
+        memset(&ring_buffer->condition, 0, sizeof(pthread_cond_t));
+        pthread_mutex_destroy(&ring_buffer->lock);
+        memset(&ring_buffer->lock, 0, sizeof(pthread_mutex_t));
+
+        free(ring_buffer->array);
+        ring_buffer->array = NULL;
+        free(ring_buffer);
+    }
+}
+
+void *john_spsc_ring_buffer_read(JohnSpscRingBuffer *ring_buffer, int32_t timeout_millis) {
+    void *result = NULL;
+    if (!ring_buffer) {
+        return result;
+    }
+    if (john_spsc_ring_buffer_try_read(ring_buffer, &result)) {
+        return result;
+    }
+    result = ring_buffer->return_on_empty;
+    if (timeout_millis == 0) {
+        return result;
+    }
+
+    struct timespec deadline;
+    if (timeout_millis > 0) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout_millis / 1000;
+        deadline.tv_nsec += (timeout_millis % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            ++deadline.tv_sec;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    int rc = 0;
+    pthread_mutex_lock(&ring_buffer->lock);
+    while (true) {
+        /* pairs with the seq_cst store of write_index and load of waiting in write(); the fence keeps the acquire
+         * load of write_index in try_read() from moving before this store, or both sides could miss each other */
+        atomic_store(&ring_buffer->waiting, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (john_spsc_ring_buffer_try_read(ring_buffer, &result) || rc == ETIMEDOUT) {
+            break;
+        }
+        if (timeout_millis < 0) {
+            pthread_cond_wait(&ring_buffer->condition, &ring_buffer->lock);
+        } else {
+            rc = pthread_cond_timedwait(&ring_buffer->condition, &ring_buffer->lock, &deadline);
+        }
+    }
+    atomic_store(&ring_buffer->waiting, 0);
+    pthread_mutex_unlock(&ring_buffer->lock);
+    return result;
+}
+
+void *john_spsc_ring_buffer_write(JohnSpscRingBuffer *ring_buffer, void *data) {
+    void *older = NULL;
+    if (!ring_buffer || !data) {
+        return older;
+    }
+    uint32_t write_index = atomic_load_explicit(&ring_buffer->write_index, memory_order_relaxed);
+    uint32_t read_index = atomic_load_explicit(&ring_buffer->read_index, memory_order_acquire);
+    while (write_index - read_index >= ring_buffer->capacity) { /* is full, evict the oldest */
+        older = atomic_load_explicit(&ring_buffer->array[read_index & ring_buffer->mask], memory_order_relaxed);
+        if (atomic_compare_exchange_strong_explicit(&ring_buffer->read_index, &read_index, read_index + 1,
+                                                    memory_order_acq_rel, memory_order_acquire)) {
+            break;
+        }
+        older = NULL; /* the reader took it first */
+    }
+    atomic_store_explicit(&ring_buffer->array[write_index & ring_buffer->mask], data, memory_order_relaxed);
+    atomic_store(&ring_buffer->write_index, write_index + 1);
+    if (atomic_load(&ring_buffer->waiting)) {
+        pthread_mutex_lock(&ring_buffer->lock);
+        pthread_cond_signal(&ring_buffer->condition);
+        pthread_mutex_unlock(&ring_buffer->lock);
+    }
+    return older;
+}
+
+uint32_t john_spsc_ring_buffer_capacity(JohnSpscRingBuffer *ring_buffer) {
+    return ring_buffer ? ring_buffer->capacity : 0;
+}
+
+bool john_spsc_ring_buffer_is_empty(JohnSpscRingBuffer *ring_buffer) {
+    return ring_buffer && atomic_load_explicit(&ring_buffer->read_index, memory_order_acquire) ==
+                          atomic_load_explicit(&ring_buffer->write_index, memory_order_acquire);
+}
+
+void john_spsc_ring_buffer_clear(JohnSpscRingBuffer *ring_buffer) {
+    if (ring_buffer) {
+        uint32_t read_index = atomic_load_explicit(&ring_buffer->read_index, memory_order_acquire);
+        uint32_t write_index;
+        do {
+            write_index = atomic_load_explicit(&ring_buffer->write_index, memory_order_acquire);
+        } while (!atomic_compare_exchange_weak_explicit(&ring_buffer->read_index, &read_index, write_index,
+                                                        memory_order_acq_rel, memory_order_acquire));
+    }
+}
@@ -0,0 +1,51 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Lock-free ring buffer for exactly one writer thread and one reader thread.
+ * Capacity is rounded up to a power of two. When full, write overwrites the oldest
+ * element and hands it back to the writer (like john_ring_buffer_write).
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#ifndef __JOHN_SPSC_RING_BUFFER_H__
+#define __JOHN_SPSC_RING_BUFFER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct JohnSpscRingBuffer JohnSpscRingBuffer;
+
+JohnSpscRingBuffer *john_spsc_ring_buffer_create(uint32_t capacity, void *return_on_empty);
+void john_spsc_ring_buffer_destroy(JohnSpscRingBuffer *ring_buffer);
+/* reader thread only; timeout_millis: 0 no wait, < 0 wait forever */
+void *john_spsc_ring_buffer_read(JohnSpscRingBuffer *ring_buffer, int32_t timeout_millis);
+/* writer thread only; returns the overwritten oldest element (owned by caller) or NULL */
+void *john_spsc_ring_buffer_write(JohnSpscRingBuffer *ring_buffer, void *data);
+uint32_t john_spsc_ring_buffer_capacity(JohnSpscRingBuffer *ring_buffer);
+bool john_spsc_ring_buffer_is_empty(JohnSpscRingBuffer *ring_buffer);
+/* reader thread only */
+void john_spsc_ring_buffer_clear(JohnSpscRingBuffer *ring_buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JOHN_SPSC_RING_BUFFER_H__ */
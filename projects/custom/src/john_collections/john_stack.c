@@ -52,7 +52,7 @@ void john_stack_destroy(JohnStack *stack) {
 }
 
 bool john_stack_push(JohnStack *stack, void *data) {
-    if (stack && data && stack->pointer < stack->capacity) {
+    if (stack && data && stack->pointer + 1 < (int32_t) stack->capacity) {
         stack->array[++stack->pointer] = data;
         return true;
     }
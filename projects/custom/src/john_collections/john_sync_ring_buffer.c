@@ -25,6 +25,8 @@
 #include "john_ring_buffer.h"
 #include "john_sync_ring_buffer.h"
 
+#define JOHN_SYNC_RING_BUFFER_DRAIN_CHUNK 64
+
 struct JohnSyncRingBuffer {
     JohnRingBuffer *ring_buffer;
     void *return_on_empty;
@@ -113,3 +115,85 @@ void john_sync_ring_buffer_clear(JohnSyncRingBuffer *ring_buffer) {
         pthread_mutex_unlock(&ring_buffer->lock);
     }
 }
+
+void john_sync_ring_buffer_write_n(JohnSyncRingBuffer *ring_buffer, void **data, uint32_t count) {
+    if (ring_buffer && data && count > 0) {
+        bool written = false;
+        pthread_mutex_lock(&ring_buffer->lock);
+        for (uint32_t i = 0; i < count; ++i) {
+            if (!data[i]) { /* skipped like in write(), a reader could not tell it from an empty buffer */
+                continue;
+            }
+            void *older = john_ring_buffer_write(ring_buffer->ring_buffer, data[i]);
+            if (older) {
+                free(older);
+            }
+            written = true;
+        }
+        if (written) {
+            pthread_cond_broadcast(&ring_buffer->condition);
+        }
+        pthread_mutex_unlock(&ring_buffer->lock);
+    }
+}
+
+uint32_t john_sync_ring_buffer_read_n(JohnSyncRingBuffer *ring_buffer, void **data, uint32_t max_count,
+                                      int32_t timeout_millis) {
+    uint32_t result = 0;
+    if (!ring_buffer || !data || max_count == 0) {
+        return result;
+    }
+    pthread_mutex_lock(&ring_buffer->lock);
+    void *first = john_ring_buffer_read(ring_buffer->ring_buffer, ring_buffer->return_on_empty);
+    if (first == ring_buffer->return_on_empty && timeout_millis != 0) {
+        int rc = 0;
+        struct timespec now;
+        if (timeout_millis > 0) {
+            clock_gettime(CLOCK_REALTIME, &now);
+            now.tv_sec += timeout_millis / 1000;
+            now.tv_nsec += (timeout_millis % 1000) * 1000000;
+            if (now.tv_nsec >= 1000000000) {
+                ++now.tv_sec;
+                now.tv_nsec -= 1000000000;
+            }
+        }
+        while (first == ring_buffer->return_on_empty && rc != ETIMEDOUT) {
+            if (timeout_millis < 0) {
+                pthread_cond_wait(&ring_buffer->condition, &ring_buffer->lock);
+            } else {
+                rc = pthread_cond_timedwait(&ring_buffer->condition, &ring_buffer->lock, &now);
+            }
+            first = john_ring_buffer_read(ring_buffer->ring_buffer, ring_buffer->return_on_empty);
+        }
+    }
+    if (first != ring_buffer->return_on_empty) {
+        void *next;
+        data[result++] = first;
+        while (result < max_count &&
+               (next = john_ring_buffer_read(ring_buffer->ring_buffer, ring_buffer->return_on_empty)) !=
+               ring_buffer->return_on_empty) {
+            data[result++] = next;
+        }
+    }
+    pthread_mutex_unlock(&ring_buffer->lock);
+    return result;
+}
+
+uint32_t john_sync_ring_buffer_drain(JohnSyncRingBuffer *ring_buffer,
+                                     void (*func)(void *data, void *user_client_params), void *user_client_params) {
+    uint32_t result = 0;
+    if (ring_buffer) {
+        void *chunk[JOHN_SYNC_RING_BUFFER_DRAIN_CHUNK];
+        uint32_t size;
+        do {
+            size = john_sync_ring_buffer_read_n(ring_buffer, chunk, JOHN_SYNC_RING_BUFFER_DRAIN_CHUNK, 0);
+            if (func) {
+                for (uint32_t i = 0; i < size; ++i) {
+                    func(chunk[i], user_client_params);
+                }
+            }
+            result += size;
+        } while (size == JOHN_SYNC_RING_BUFFER_DRAIN_CHUNK);
+    }
+    return result;
+}
@@ -35,6 +35,14 @@ void john_sync_ring_buffer_destroy(JohnSyncRingBuffer *ring_buffer);
 void *john_sync_ring_buffer_read(JohnSyncRingBuffer *ring_buffer, int32_t timeout_millis);
 void john_sync_ring_buffer_write(JohnSyncRingBuffer *ring_buffer, void *data);
 void john_sync_ring_buffer_clear(JohnSyncRingBuffer *ring_buffer);
+/* batch variants, one lock round trip and one wake-up per batch; NULL elements are skipped, as by write() */
+void john_sync_ring_buffer_write_n(JohnSyncRingBuffer *ring_buffer, void **data, uint32_t count);
+/* waits (per timeout) until there is at least one element, returns how many were read */
+uint32_t john_sync_ring_buffer_read_n(JohnSyncRingBuffer *ring_buffer, void **data, uint32_t max_count,
+                                      int32_t timeout_millis);
+/* remove every element without waiting, func (e.g. free) is called outside the lock */
+uint32_t john_sync_ring_buffer_drain(JohnSyncRingBuffer *ring_buffer,
+                                     void (*func)(void *data, void *user_client_params), void *user_client_params);
 
 #ifdef __cplusplus
 }
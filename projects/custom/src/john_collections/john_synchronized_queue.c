@@ -22,10 +22,11 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <memory.h>
-#include <AppleTextureEncoder.h>
 #include "john_queue.h"
 #include "john_synchronized_queue.h"
 
+#define JOHN_SYNCHRONIZED_QUEUE_DRAIN_CHUNK 64
+
 struct JohnSynchronizedQueue {
     JohnQueue *queue;
     bool replace_oldest;
@@ -35,6 +36,39 @@ struct JohnSynchronizedQueue {
     pthread_cond_t full_condition;
 };
 
+/* must hold lock; waits (per timeout) while predicate is true, returns whether it became false */
+static bool john_synchronized_queue_wait(JohnSynchronizedQueue *synchronized_queue, pthread_cond_t *condition,
+                                         bool (*predicate)(JohnQueue *queue), int32_t timeout_millis) {
+    if (!predicate(synchronized_queue->queue)) {
+        return true;
+    } else if (timeout_millis == 0) {
+        return false;
+    } else if (timeout_millis < 0) {
+        while (predicate(synchronized_queue->queue)) {
+            pthread_cond_wait(condition, &synchronized_queue->lock);
+        }
+        return true;
+    } else { /* timeout_millis > 0 */
+        int rc;
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        now.tv_sec += timeout_millis / 1000;
+        now.tv_nsec += (timeout_millis % 1000) * 1000000;
+        if (now.tv_nsec >= 1000000000) {
+            ++now.tv_sec;
+            now.tv_nsec -= 1000000000;
+        }
+        while (true) {
+            rc = pthread_cond_timedwait(condition, &synchronized_queue->lock, &now);
+            if (!predicate(synchronized_queue->queue)) {
+                return true;
+            } else if (rc == ETIMEDOUT) {
+                return false;
+            }
+        }
+    }
+}
+
 JohnSynchronizedQueue *john_synchronized_queue_create(uint32_t capacity,
                                                       bool replace_oldest, void *return_on_empty) {
     JohnSynchronizedQueue *synchronized_queue = (JohnSynchronizedQueue *) malloc(sizeof(JohnSynchronizedQueue));
@@ -218,3 +252,70 @@ void john_synchronized_queue_clear(JohnSynchronizedQueue *synchronized_queue) {
         pthread_mutex_unlock(&synchronized_queue->lock);
     }
 }
+
+uint32_t john_synchronized_queue_enqueue_n(JohnSynchronizedQueue *synchronized_queue, void **data, uint32_t count,
+                                           int32_t timeout_millis) {
+    uint32_t result = 0;
+    if (!synchronized_queue || !data || count == 0) {
+        return result;
+    }
+    pthread_mutex_lock(&synchronized_queue->lock);
+    if (john_synchronized_queue_wait(synchronized_queue, &synchronized_queue->full_condition,
+                                     john_queue_is_full, timeout_millis) || synchronized_queue->replace_oldest) {
+        while (result < count) {
+            if (john_queue_is_full(synchronized_queue->queue)) {
+                if (!synchronized_queue->replace_oldest) {
+                    break;
+                }
+                john_queue_dequeue(synchronized_queue->queue);
+            }
+            if (!john_queue_enqueue(synchronized_queue->queue, data[result])) {
+                break;
+            }
+            ++result;
+        }
+        if (result > 0) {
+            pthread_cond_broadcast(&synchronized_queue->empty_condition);
+        }
+    }
+    pthread_mutex_unlock(&synchronized_queue->lock);
+    return result;
+}
+
+uint32_t john_synchronized_queue_dequeue_n(JohnSynchronizedQueue *synchronized_queue, void **data, uint32_t max_count,
+                                           int32_t timeout_millis) {
+    uint32_t result = 0;
+    if (!synchronized_queue || !data || max_count == 0) {
+        return result;
+    }
+    pthread_mutex_lock(&synchronized_queue->lock);
+    if (john_synchronized_queue_wait(synchronized_queue, &synchronized_queue->empty_condition,
+                                     john_queue_is_empty, timeout_millis)) {
+        result = john_queue_dequeue_n(synchronized_queue->queue, data, max_count);
+        if (result > 0) {
+            pthread_cond_broadcast(&synchronized_queue->full_condition);
+        }
+    }
+    pthread_mutex_unlock(&synchronized_queue->lock);
+    return result;
+}
+
+uint32_t john_synchronized_queue_drain(JohnSynchronizedQueue *synchronized_queue,
+                                       void (*func)(void *data, void *user_client_params), void *user_client_params) {
+    uint32_t result = 0;
+    if (synchronized_queue) {
+        void *chunk[JOHN_SYNCHRONIZED_QUEUE_DRAIN_CHUNK];
+        uint32_t size;
+        do {
+            size = john_synchronized_queue_dequeue_n(synchronized_queue, chunk,
+                                                     JOHN_SYNCHRONIZED_QUEUE_DRAIN_CHUNK, 0);
+            if (func) {
+                for (uint32_t i = 0; i < size; ++i) {
+                    func(chunk[i], user_client_params);
+                }
+            }
+            result += size;
+        } while (size == JOHN_SYNCHRONIZED_QUEUE_DRAIN_CHUNK);
+    }
+    return result;
+}
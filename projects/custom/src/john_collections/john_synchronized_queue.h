@@ -40,6 +40,16 @@ void *john_synchronized_queue_tail(JohnSynchronizedQueue *synchronized_queue);
 bool john_synchronized_queue_is_full(JohnSynchronizedQueue *synchronized_queue);
 bool john_synchronized_queue_is_empty(JohnSynchronizedQueue *synchronized_queue);
 void john_synchronized_queue_clear(JohnSynchronizedQueue *synchronized_queue);
+/* batch variants, one lock round trip and one wake-up per batch, return how many elements were moved.
+ * enqueue_n waits (per timeout) until there is room for one element, with replace_oldest it makes room for all;
+ * dequeue_n waits (per timeout) until there is at least one element. */
+uint32_t john_synchronized_queue_enqueue_n(JohnSynchronizedQueue *synchronized_queue, void **data, uint32_t count,
+                                           int32_t timeout_millis);
+uint32_t john_synchronized_queue_dequeue_n(JohnSynchronizedQueue *synchronized_queue, void **data, uint32_t max_count,
+                                           int32_t timeout_millis);
+/* remove every element without waiting, func (e.g. free) is called outside the lock */
+uint32_t john_synchronized_queue_drain(JohnSynchronizedQueue *synchronized_queue,
+                                       void (*func)(void *data, void *user_client_params), void *user_client_params);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,183 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Follows "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al., PPoPP 2013).
+ * top and bottom only ever grow (int64_t, no wrap in practice), slot = index & mask.
+ * Buffers replaced by a grow are kept until destroy, a thief may still be reading them.
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <memory.h>
+#include "john_work_stealing_deque.h"
+
+#define JOHN_CACHE_LINE_SIZE 64
+
+typedef struct JohnDequeBuffer {
+    int64_t mask;
+    struct JohnDequeBuffer *retired; /* the buffer this one replaced */
+    _Atomic(void *) array[];
+} JohnDequeBuffer;
+
+struct JohnWorkStealingDeque {
+    atomic_llong top; /* written by thieves, and by owner when taking the last element */
+    char top_padding[JOHN_CACHE_LINE_SIZE - sizeof(atomic_llong)];
+    atomic_llong bottom; /* written by owner */
+    char bottom_padding[JOHN_CACHE_LINE_SIZE - sizeof(atomic_llong)];
+    _Atomic(JohnDequeBuffer *) buffer;
+};
+
+static JohnDequeBuffer *john_deque_buffer_create(int64_t capacity) {
+    JohnDequeBuffer *buffer = (JohnDequeBuffer *) malloc(sizeof(JohnDequeBuffer) + sizeof(_Atomic(void *)) * capacity);
+    if (buffer) {
+        buffer->mask = capacity - 1;
+        buffer->retired = NULL;
+        for (int64_t i = 0; i < capacity; ++i) {
+            atomic_init(&buffer->array[i], NULL);
+        }
+    }
+    return buffer;
+}
+
+/* owner thread only */
+static JohnDequeBuffer *john_deque_buffer_grow(JohnWorkStealingDeque *deque, JohnDequeBuffer *buffer,
+                                               int64_t top, int64_t bottom) {
+    JohnDequeBuffer *bigger = john_deque_buffer_create((buffer->mask + 1) * 2);
+    if (!bigger) {
+        return NULL;
+    }
+    for (int64_t i = top; i < bottom; ++i) {
+        atomic_store_explicit(&bigger->array[i & bigger->mask],
+                              atomic_load_explicit(&buffer->array[i & buffer->mask], memory_order_relaxed),
+                              memory_order_relaxed);
+    }
+    bigger->retired = buffer;
+    atomic_store_explicit(&deque->buffer, bigger, memory_order_release);
+    return bigger;
+}
+
+JohnWorkStealingDeque *john_work_stealing_deque_create(uint32_t capacity) {
+    if (capacity == 0 || capacity > (1U << 31)) {
+        return NULL;
+    }
+    uint32_t power_of_two = 1;
+    while (power_of_two < capacity) {
+        power_of_two <<= 1;
+    }
+
+    JohnWorkStealingDeque *deque = (JohnWorkStealingDeque *) malloc(sizeof(JohnWorkStealingDeque));
+    if (deque) {
+        memset(deque, 0, sizeof(JohnWorkStealingDeque));
+        JohnDequeBuffer *buffer = john_deque_buffer_create(power_of_two);
+        if (!buffer) {
+            free(deque);
+            return NULL;
+        }
+        atomic_init(&deque->top, 0);
+        atomic_init(&deque->bottom, 0);
+        atomic_init(&deque->buffer, buffer);
+    }
+    return deque;
+}
+
+void john_work_stealing_deque_destroy(JohnWorkStealingDeque *deque) {
+    if (deque) {
+        JohnDequeBuffer *buffer = atomic_load_explicit(&deque->buffer, memory_order_relaxed);
+        while (buffer) {
+            JohnDequeBuffer *retired = buffer->retired;
+            free(buffer);
+            buffer = retired;
+        }
+        free(deque);
+    }
+}
+
+bool john_work_stealing_deque_push(JohnWorkStealingDeque *deque, void *data) {
+    if (!deque || !data) {
+        return false;
+    }
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    JohnDequeBuffer *buffer = atomic_load_explicit(&deque->buffer, memory_order_relaxed);
+    if (bottom - top > buffer->mask) { /* is full */
+        if (!(buffer = john_deque_buffer_grow(deque, buffer, top, bottom))) {
+            return false;
+        }
+    }
+    atomic_store_explicit(&buffer->array[bottom & buffer->mask], data, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return true;
+}
+
+void *john_work_stealing_deque_pop(JohnWorkStealingDeque *deque) {
+    void *result = NULL;
+    if (!deque) {
+        return result;
+    }
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    JohnDequeBuffer *buffer = atomic_load_explicit(&deque->buffer, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+    if (top <= bottom) {
+        result = atomic_load_explicit(&buffer->array[bottom & buffer->mask], memory_order_relaxed);
+        if (top == bottom) { /* the last element, race the thieves for it */
+            if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                         memory_order_seq_cst, memory_order_relaxed)) {
+                result = NULL;
+            }
+            atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        }
+    } else { /* is empty */
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return result;
+}
+
+void *john_work_stealing_deque_steal(JohnWorkStealingDeque *deque) {
+    void *result = NULL;
+    if (!deque) {
+        return result;
+    }
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (top < bottom) {
+        JohnDequeBuffer *buffer = atomic_load_explicit(&deque->buffer, memory_order_acquire);
+        result = atomic_load_explicit(&buffer->array[top & buffer->mask], memory_order_relaxed);
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                     memory_order_seq_cst, memory_order_relaxed)) {
+            result = NULL; /* lost the race */
+        }
+    }
+    return result;
+}
+
+uint32_t john_work_stealing_deque_size(JohnWorkStealingDeque *deque) {
+    if (!deque) {
+        return 0;
+    }
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    return bottom > top ? (uint32_t) (bottom - top) : 0;
+}
+
+bool john_work_stealing_deque_is_empty(JohnWorkStealingDeque *deque) {
+    return john_work_stealing_deque_size(deque) == 0;
+}
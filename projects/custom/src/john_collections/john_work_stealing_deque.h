@@ -0,0 +1,53 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Chase-Lev work-stealing deque: the owner thread pushes and pops at the bottom (LIFO),
+ * any other thread steals from the top (FIFO). The buffer grows on demand; the owner is
+ * never blocked by thieves and thieves only contend with each other on a single CAS.
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#ifndef __JOHN_WORK_STEALING_DEQUE_H__
+#define __JOHN_WORK_STEALING_DEQUE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct JohnWorkStealingDeque JohnWorkStealingDeque;
+
+/* capacity is rounded up to a power of two and doubled whenever push finds the deque full */
+JohnWorkStealingDeque *john_work_stealing_deque_create(uint32_t capacity);
+void john_work_stealing_deque_destroy(JohnWorkStealingDeque *deque);
+/* owner thread only; fails only if growing the buffer fails */
+bool john_work_stealing_deque_push(JohnWorkStealingDeque *deque, void *data);
+/* owner thread only; NULL if empty */
+void *john_work_stealing_deque_pop(JohnWorkStealingDeque *deque);
+/* any thread; NULL if empty or another thread won the race for the top element */
+void *john_work_stealing_deque_steal(JohnWorkStealingDeque *deque);
+/* snapshot, may be stale under concurrent use */
+uint32_t john_work_stealing_deque_size(JohnWorkStealingDeque *deque);
+bool john_work_stealing_deque_is_empty(JohnWorkStealingDeque *deque);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JOHN_WORK_STEALING_DEQUE_H__ */
@@ -0,0 +1,270 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * pending counts submitted tasks not yet taken by a worker, a worker parks only when it is 0.
+ * Submitters bump pending before publishing and wake a worker only if sleepers is non-zero;
+ * both sides use seq_cst so that either the worker sees the task or the submitter sees the sleeper.
+ * Note: We did not check if the pthread related function call succeeded
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <memory.h>
+#include <unistd.h>
+#include "john_work_stealing_deque.h"
+#include "john_mpmc_queue.h"
+#include "john_object_pool.h"
+#include "john_worker_pool.h"
+
+#define JOHN_WORKER_DEQUE_CAPACITY 256
+#define JOHN_WORKER_INBOX_CAPACITY 1024
+
+typedef struct JohnWorkerTask {
+    JohnWorkerTaskFunc func;
+    void *params;
+} JohnWorkerTask;
+
+typedef struct JohnWorker {
+    JohnWorkerPool *worker_pool;
+    uint32_t index;
+    uint32_t seed; /* victim selection */
+    pthread_t thread;
+    JohnWorkStealingDeque *deque;
+    JohnMpmcQueue *inbox;
+} JohnWorker;
+
+struct JohnWorkerPool {
+    JohnWorker *workers;
+    uint32_t thread_count;
+    uint32_t started_count;
+    JohnObjectPool *task_pool;
+    pthread_key_t worker_key;
+
+    atomic_uint next_inbox;
+    atomic_uint pending;
+    atomic_uint sleepers;
+    atomic_uint unfinished;
+    bool stopping; /* guarded by lock */
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_condition;
+    pthread_cond_t idle_condition;
+};
+
+static void *john_worker_task_create(void *user_client_params) {
+    return malloc(sizeof(JohnWorkerTask));
+}
+
+static JohnWorkerTask *john_worker_find_task(JohnWorker *worker) {
+    JohnWorkerPool *worker_pool = worker->worker_pool;
+    JohnWorkerTask *task = (JohnWorkerTask *) john_work_stealing_deque_pop(worker->deque);
+    if (!task) {
+        task = (JohnWorkerTask *) john_mpmc_queue_dequeue(worker->inbox, 0);
+    }
+    if (!task && worker_pool->thread_count > 1) {
+        /* xorshift, so that thieves do not all hit the same victim first */
+        worker->seed ^= worker->seed << 13;
+        worker->seed ^= worker->seed >> 17;
+        worker->seed ^= worker->seed << 5;
+        uint32_t start = worker->seed % worker_pool->thread_count;
+        for (uint32_t i = 0; i < worker_pool->thread_count && !task; ++i) {
+            JohnWorker *victim = &worker_pool->workers[(start + i) % worker_pool->thread_count];
+            if (victim == worker) {
+                continue;
+            }
+            task = (JohnWorkerTask *) john_work_stealing_deque_steal(victim->deque);
+            if (!task) {
+                task = (JohnWorkerTask *) john_mpmc_queue_dequeue(victim->inbox, 0);
+            }
+        }
+    }
+    return task;
+}
+
+static void *john_worker_run(void *params) {
+    JohnWorker *worker = (JohnWorker *) params;
+    JohnWorkerPool *worker_pool = worker->worker_pool;
+    pthread_setspecific(worker_pool->worker_key, worker);
+    while (true) {
+        JohnWorkerTask *task = john_worker_find_task(worker);
+        if (task) {
+            atomic_fetch_sub(&worker_pool->pending, 1);
+            JohnWorkerTaskFunc func = task->func;
+            void *task_params = task->params;
+            john_object_pool_recycle(worker_pool->task_pool, task);
+            func(task_params);
+            if (atomic_fetch_sub(&worker_pool->unfinished, 1) == 1) {
+                pthread_mutex_lock(&worker_pool->lock);
+                pthread_cond_broadcast(&worker_pool->idle_condition);
+                pthread_mutex_unlock(&worker_pool->lock);
+            }
+            continue;
+        }
+        if (atomic_load(&worker_pool->pending) > 0) {
+            /* a task is being published right now, or a thief beat us to it */
+            sched_yield();
+            continue;
+        }
+        bool stop;
+        pthread_mutex_lock(&worker_pool->lock);
+        atomic_fetch_add(&worker_pool->sleepers, 1);
+        while (atomic_load(&worker_pool->pending) == 0 && !worker_pool->stopping) {
+            pthread_cond_wait(&worker_pool->work_condition, &worker_pool->lock);
+        }
+        atomic_fetch_sub(&worker_pool->sleepers, 1);
+        stop = worker_pool->stopping && atomic_load(&worker_pool->pending) == 0;
+        pthread_mutex_unlock(&worker_pool->lock);
+        if (stop) {
+            break;
+        }
+    }
+    john_object_pool_flush_thread_cache(worker_pool->task_pool);
+    return NULL;
+}
+
+JohnWorkerPool *john_worker_pool_create(uint32_t thread_count) {
+    if (thread_count == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = online > 0 ? (uint32_t) online : 1;
+    }
+    JohnWorkerPool *worker_pool = (JohnWorkerPool *) malloc(sizeof(JohnWorkerPool));
+    if (!worker_pool) {
+        return NULL;
+    }
+    memset(worker_pool, 0, sizeof(JohnWorkerPool));
+    worker_pool->thread_count = thread_count;
+    atomic_init(&worker_pool->next_inbox, 0);
+    atomic_init(&worker_pool->pending, 0);
+    atomic_init(&worker_pool->sleepers, 0);
+    atomic_init(&worker_pool->unfinished, 0);
+    pthread_mutex_init(&worker_pool->lock, NULL);
+    pthread_cond_init(&worker_pool->work_condition, NULL);
+    pthread_cond_init(&worker_pool->idle_condition, NULL);
+    pthread_key_create(&worker_pool->worker_key, NULL);
+
+    JohnObjectDelegate delegate = { NULL, john_worker_task_create, NULL, NULL };
+    worker_pool->task_pool = john_object_pool_create(UINT32_MAX, JOHN_WORKER_INBOX_CAPACITY, 0, &delegate);
+    worker_pool->workers = (JohnWorker *) malloc(sizeof(JohnWorker) * thread_count);
+    if (!worker_pool->task_pool || !worker_pool->workers) {
+        goto fail;
+    }
+    memset(worker_pool->workers, 0, sizeof(JohnWorker) * thread_count);
+    for (uint32_t i = 0; i < thread_count; ++i) {
+        JohnWorker *worker = &worker_pool->workers[i];
+        worker->worker_pool = worker_pool;
+        worker->index = i;
+        worker->seed = 2654435761U * (i + 1);
+        worker->deque = john_work_stealing_deque_create(JOHN_WORKER_DEQUE_CAPACITY);
+        worker->inbox = john_mpmc_queue_create(JOHN_WORKER_INBOX_CAPACITY, false, NULL);
+        if (!worker->deque || !worker->inbox) {
+            goto fail;
+        }
+    }
+    for (uint32_t i = 0; i < thread_count; ++i) {
+        if (pthread_create(&worker_pool->workers[i].thread, NULL, john_worker_run, &worker_pool->workers[i]) != 0) {
+            goto fail;
+        }
+        ++worker_pool->started_count;
+    }
+    goto success;
+fail:
+    john_worker_pool_destroy(worker_pool);
+    worker_pool = NULL;
+success:
+    return worker_pool;
+}
+
+void john_worker_pool_destroy(JohnWorkerPool *worker_pool) {
+    if (worker_pool) {
+        pthread_mutex_lock(&worker_pool->lock);
+        worker_pool->stopping = true;
+        pthread_cond_broadcast(&worker_pool->work_condition);
+        pthread_mutex_unlock(&worker_pool->lock);
+        for (uint32_t i = 0; i < worker_pool->started_count; ++i) {
+            pthread_join(worker_pool->workers[i].thread, NULL);
+        }
+        if (worker_pool->workers) {
+            for (uint32_t i = 0; i < worker_pool->thread_count; ++i) {
+                john_work_stealing_deque_destroy(worker_pool->workers[i].deque);
+                john_mpmc_queue_destroy(worker_pool->workers[i].inbox);
+            }
+            free(worker_pool->workers);
+            worker_pool->workers = NULL;
+        }
+        john_object_pool_destroy(worker_pool->task_pool);
+        worker_pool->task_pool = NULL;
+
+        pthread_key_delete(worker_pool->worker_key);
+        pthread_cond_destroy(&worker_pool->idle_condition);
+        pthread_cond_destroy(&worker_pool->work_condition);
+        pthread_mutex_destroy(&worker_pool->lock);
+        free(worker_pool);
+    }
+}
+
+bool john_worker_pool_submit(JohnWorkerPool *worker_pool, JohnWorkerTaskFunc func, void *params) {
+    if (!worker_pool || !func) {
+        return false;
+    }
+    JohnWorkerTask *task = (JohnWorkerTask *) john_object_pool_obtain(worker_pool->task_pool);
+    if (!task) {
+        return false;
+    }
+    task->func = func;
+    task->params = params;
+    atomic_fetch_add(&worker_pool->unfinished, 1);
+    atomic_fetch_add(&worker_pool->pending, 1);
+
+    JohnWorker *worker = (JohnWorker *) pthread_getspecific(worker_pool->worker_key);
+    if (!worker || !john_work_stealing_deque_push(worker->deque, task)) {
+        uint32_t index = atomic_fetch_add_explicit(&worker_pool->next_inbox, 1, memory_order_relaxed);
+        worker = &worker_pool->workers[index % worker_pool->thread_count];
+        john_mpmc_queue_enqueue(worker->inbox, task, -1);
+    }
+
+    if (atomic_load(&worker_pool->sleepers) > 0) {
+        pthread_mutex_lock(&worker_pool->lock);
+        pthread_cond_signal(&worker_pool->work_condition);
+        pthread_mutex_unlock(&worker_pool->lock);
+    }
+    return true;
+}
+
+void john_worker_pool_wait_idle(JohnWorkerPool *worker_pool) {
+    if (worker_pool) {
+        pthread_mutex_lock(&worker_pool->lock);
+        while (atomic_load(&worker_pool->unfinished) > 0) {
+            pthread_cond_wait(&worker_pool->idle_condition, &worker_pool->lock);
+        }
+        pthread_mutex_unlock(&worker_pool->lock);
+    }
+}
+
+uint32_t john_worker_pool_thread_count(JohnWorkerPool *worker_pool) {
+    return worker_pool ? worker_pool->thread_count : 0;
+}
+
+int32_t john_worker_pool_current_index(JohnWorkerPool *worker_pool) {
+    if (!worker_pool) {
+        return -1;
+    }
+    JohnWorker *worker = (JohnWorker *) pthread_getspecific(worker_pool->worker_key);
+    return worker ? (int32_t) worker->index : -1;
+}
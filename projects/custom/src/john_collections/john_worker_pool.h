@@ -0,0 +1,56 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Fixed set of worker threads, each owning a JohnWorkStealingDeque.
+ * Tasks submitted from a worker go to the bottom of its own deque; tasks submitted from
+ * any other thread go round-robin to a per-worker inbox (JohnMpmcQueue). An idle worker
+ * drains its own deque, then its inbox, then steals from the others before parking,
+ * so there is no global run queue to contend on.
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#ifndef __JOHN_WORKER_POOL_H__
+#define __JOHN_WORKER_POOL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef void (*JohnWorkerTaskFunc)(void *params);
+
+typedef struct JohnWorkerPool JohnWorkerPool;
+
+/* thread_count 0 means one worker per online cpu */
+JohnWorkerPool *john_worker_pool_create(uint32_t thread_count);
+/* runs every task already submitted, then joins the workers */
+void john_worker_pool_destroy(JohnWorkerPool *worker_pool);
+/* blocks only if the chosen worker's inbox is full */
+bool john_worker_pool_submit(JohnWorkerPool *worker_pool, JohnWorkerTaskFunc func, void *params);
+/* blocks until every submitted task, including those submitted by tasks, has finished */
+void john_worker_pool_wait_idle(JohnWorkerPool *worker_pool);
+uint32_t john_worker_pool_thread_count(JohnWorkerPool *worker_pool);
+/* index of the calling worker thread in [0, thread_count), or -1 if not a worker of this pool */
+int32_t john_worker_pool_current_index(JohnWorkerPool *worker_pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JOHN_WORKER_POOL_H__ */
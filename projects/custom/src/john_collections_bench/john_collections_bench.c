@@ -0,0 +1,822 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Benchmark suite for john_collections.
+ * Handoff scenarios push preallocated elements of element_size bytes from producers to consumers
+ * and record the enqueue-to-dequeue latency of every element; pool scenarios churn obtain/release
+ * on every producer thread; the worker pool scenario records submit-to-run latency.
+ * Reported per scenario: ops/sec, p50/p99/p99.9/max latency and, on Linux when perf events
+ * are permitted, hardware cache misses of the whole run (-1 when unavailable).
+ * john_sync_ring_buffer is left out since it free()s evicted elements.
+ *
+ * usage: john_collections_bench [-n operations_per_producer] [-t symmetric_thread_counts]
+ *                               [-p producers] [-c consumers] [-s element_size] [-q capacity]
+ *                               [-b name_filter] [-f table|csv|json]
+ *   -t 1,2,4 runs 1P/1C, 2P/2C and 4P/4C (default 1,2,4,8,16); -p/-c run a single asymmetric setup;
+ *   -b keeps scenarios whose name contains one of the comma separated filters.
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#ifdef __linux__
+#define _GNU_SOURCE /* syscall */
+#endif
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#include "../john_collections/john_mpmc_queue.h"
+#include "../john_collections/john_synchronized_queue.h"
+#include "../john_collections/john_spsc_ring_buffer.h"
+#include "../john_collections/john_event_queue.h"
+#include "../john_collections/john_frame_queue.h"
+#include "../john_collections/john_byte_ring_buffer.h"
+#include "../john_collections/john_object_pool.h"
+#include "../john_collections/john_slab_arena.h"
+#include "../john_collections/john_worker_pool.h"
+
+#define MAX_THREADS 64
+#define CONSUMER_POLL_MILLIS 1
+#define POOL_BATCH 16
+
+/* log-linear histogram: values below 32ns are exact, above that 32 buckets per power of two (~3% error) */
+#define HISTOGRAM_SUB_BITS 5
+#define HISTOGRAM_SUB_COUNT (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_SIZE (64 * HISTOGRAM_SUB_COUNT)
+
+typedef struct Histogram {
+    uint64_t counts[HISTOGRAM_SIZE];
+    uint64_t total;
+    uint64_t max;
+} Histogram;
+
+typedef struct BenchElement {
+    uint64_t stamp_nanos;
+    uint64_t sequence;
+} BenchElement;
+
+typedef struct BenchOptions {
+    uint32_t operations;
+    uint32_t element_size;
+    uint32_t capacity;
+    const char *filter;
+    const char *format;
+} BenchOptions;
+
+typedef struct BenchResult {
+    const char *name;
+    int producers;
+    int consumers;
+    uint64_t operations; /* delivered handoffs, or completed obtain/release pairs */
+    uint64_t dropped;
+    double seconds;
+    Histogram histogram;
+    int64_t cache_misses;
+} BenchResult;
+
+/* queue-like containers; dequeue returns NULL after timeout_millis */
+typedef struct BenchQueue {
+    const char *name;
+    bool single_producer_consumer;
+    void *(*create)(uint32_t capacity, uint32_t element_size);
+    void (*destroy)(void *queue);
+    void (*enqueue)(void *queue, BenchElement *element, uint32_t element_size);
+    BenchElement *(*dequeue)(void *queue, uint32_t element_size, int32_t timeout_millis);
+    void (*release)(void *queue, BenchElement *element, uint32_t element_size); /* optional */
+} BenchQueue;
+
+/* allocators; obtain returns a writable block of element_size bytes */
+typedef struct BenchPool {
+    const char *name;
+    void *(*create)(uint32_t capacity, uint32_t element_size);
+    void (*destroy)(void *pool);
+    void *(*obtain)(void *pool, uint32_t element_size, void **block);
+    void (*release)(void *pool, void *handle);
+} BenchPool;
+
+static atomic_ullong dropped_count;
+
+static inline uint64_t now_nanos() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+static void histogram_record(Histogram *histogram, uint64_t value) {
+    uint32_t index;
+    if (value < HISTOGRAM_SUB_COUNT) {
+        index = (uint32_t) value;
+    } else {
+        uint32_t exponent = 63 - (uint32_t) __builtin_clzll(value);
+        uint32_t sub = (uint32_t) (value >> (exponent - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_COUNT - 1);
+        index = (exponent - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_COUNT + sub;
+    }
+    ++histogram->counts[index];
+    ++histogram->total;
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+}
+
+static void histogram_merge(Histogram *into, const Histogram *from) {
+    for (uint32_t i = 0; i < HISTOGRAM_SIZE; ++i) {
+        into->counts[i] += from->counts[i];
+    }
+    into->total += from->total;
+    if (from->max > into->max) {
+        into->max = from->max;
+    }
+}
+
+/* lower bound of the bucket holding the given quantile */
+static uint64_t histogram_percentile(const Histogram *histogram, double quantile) {
+    if (histogram->total == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t) (quantile * (double) (histogram->total - 1)) + 1, seen = 0;
+    for (uint32_t i = 0; i < HISTOGRAM_SIZE; ++i) {
+        seen += histogram->counts[i];
+        if (seen >= rank) {
+            if (i < HISTOGRAM_SUB_COUNT) {
+                return i;
+            }
+            uint32_t exponent = i / HISTOGRAM_SUB_COUNT + HISTOGRAM_SUB_BITS - 1;
+            uint64_t sub = i % HISTOGRAM_SUB_COUNT;
+            return (HISTOGRAM_SUB_COUNT + sub) << (exponent - HISTOGRAM_SUB_BITS);
+        }
+    }
+    return histogram->max;
+}
+
+/************************* cache misses *************************/
+
+typedef struct CacheCounter {
+    int fd;
+} CacheCounter;
+
+/* counts the calling thread and every thread it creates afterwards */
+static void cache_counter_start(CacheCounter *counter) {
+    counter->fd = -1;
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    counter->fd = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (counter->fd >= 0) {
+        ioctl(counter->fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter->fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+static int64_t cache_counter_stop(CacheCounter *counter) {
+    int64_t result = -1;
+#ifdef __linux__
+    if (counter->fd >= 0) {
+        uint64_t value;
+        ioctl(counter->fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(counter->fd, &value, sizeof(value)) == sizeof(value)) {
+            result = (int64_t) value;
+        }
+        close(counter->fd);
+    }
+#endif
+    return result;
+}
+
+/************************* queues *************************/
+
+static void *synchronized_create(uint32_t capacity, uint32_t element_size) {
+    return john_synchronized_queue_create(capacity, false, NULL);
+}
+
+static void synchronized_destroy(void *queue) {
+    john_synchronized_queue_destroy((JohnSynchronizedQueue *) queue);
+}
+
+static void synchronized_enqueue(void *queue, BenchElement *element, uint32_t element_size) {
+    john_synchronized_queue_enqueue((JohnSynchronizedQueue *) queue, element, -1);
+}
+
+static BenchElement *synchronized_dequeue(void *queue, uint32_t element_size, int32_t timeout_millis) {
+    return (BenchElement *) john_synchronized_queue_dequeue((JohnSynchronizedQueue *) queue, timeout_millis);
+}
+
+static void *mpmc_create(uint32_t capacity, uint32_t element_size) {
+    return john_mpmc_queue_create(capacity, false, NULL);
+}
+
+static void mpmc_destroy(void *queue) {
+    john_mpmc_queue_destroy((JohnMpmcQueue *) queue);
+}
+
+static void mpmc_enqueue(void *queue, BenchElement *element, uint32_t element_size) {
+    john_mpmc_queue_enqueue((JohnMpmcQueue *) queue, element, -1);
+}
+
+static BenchElement *mpmc_dequeue(void *queue, uint32_t element_size, int32_t timeout_millis) {
+    return (BenchElement *) john_mpmc_queue_dequeue((JohnMpmcQueue *) queue, timeout_millis);
+}
+
+static void *event_create(uint32_t capacity, uint32_t element_size) {
+    return john_event_queue_create(capacity, false, NULL);
+}
+
+static void event_destroy(void *queue) {
+    john_event_queue_destroy((JohnEventQueue *) queue);
+}
+
+static void event_enqueue(void *queue, BenchElement *element, uint32_t element_size) {
+    john_event_queue_enqueue((JohnEventQueue *) queue, element, -1);
+}
+
+static BenchElement *event_dequeue(void *queue, uint32_t element_size, int32_t timeout_millis) {
+    return (BenchElement *) john_event_queue_dequeue((JohnEventQueue *) queue, timeout_millis);
+}
+
+static void count_drop(void *data, void *user_client_params) {
+    atomic_fetch_add_explicit(&dropped_count, 1, memory_order_relaxed);
+}
+
+static void *frame_create(uint32_t capacity, uint32_t element_size) {
+    return john_frame_queue_create(capacity, NULL, count_drop, NULL);
+}
+
+static void frame_destroy(void *queue) {
+    john_frame_queue_destroy((JohnFrameQueue *) queue);
+}
+
+static void frame_enqueue(void *queue, BenchElement *element, uint32_t element_size) {
+    /* every 8th element is a reference frame, so the drop policy has something to choose from */
+    john_frame_queue_enqueue((JohnFrameQueue *) queue, element, element_size,
+                             element->sequence % 8 == 0 ? JOHN_FRAME_REFERENCE : JOHN_FRAME_NON_REFERENCE);
+}
+
+static BenchElement *frame_dequeue(void *queue, uint32_t element_size, int32_t timeout_millis) {
+    return (BenchElement *) john_frame_queue_dequeue((JohnFrameQueue *) queue, timeout_millis);
+}
+
+static void *spsc_create(uint32_t capacity, uint32_t element_size) {
+    return john_spsc_ring_buffer_create(capacity, NULL);
+}
+
+static void spsc_destroy(void *queue) {
+    john_spsc_ring_buffer_destroy((JohnSpscRingBuffer *) queue);
+}
+
+static void spsc_enqueue(void *queue, BenchElement *element, uint32_t element_size) {
+    if (john_spsc_ring_buffer_write((JohnSpscRingBuffer *) queue, element)) {
+        count_drop(NULL, NULL);
+    }
+}
+
+static BenchElement *spsc_dequeue(void *queue, uint32_t element_size, int32_t timeout_millis) {
+    return (BenchElement *) john_spsc_ring_buffer_read((JohnSpscRingBuffer *) queue, timeout_millis);
+}
+
+/* the element bytes are copied into the ring, capacity counts elements */
+static void *byte_create(uint32_t capacity, uint32_t element_size) {
+    return john_byte_ring_buffer_create(capacity * element_size);
+}
+
+static void byte_destroy(void *queue) {
+    john_byte_ring_buffer_destroy((JohnByteRingBuffer *) queue);
+}
+
+static void byte_enqueue(void *queue, BenchElement *element, uint32_t element_size) {
+    john_byte_ring_buffer_write((JohnByteRingBuffer *) queue, (const uint8_t *) element, element_size, -1);
+}
+
+static BenchElement *byte_dequeue(void *queue, uint32_t element_size, int32_t timeout_millis) {
+    uint32_t size;
+    return (BenchElement *) john_byte_ring_buffer_read_view((JohnByteRingBuffer *) queue, &size, timeout_millis);
+}
+
+static void byte_release(void *queue, BenchElement *element, uint32_t element_size) {
+    john_byte_ring_buffer_consume((JohnByteRingBuffer *) queue, element_size);
+}
+
+static const BenchQueue bench_queues[] = {
+        { "john_synchronized_queue", false, synchronized_create, synchronized_destroy,
+                synchronized_enqueue, synchronized_dequeue, NULL },
+        { "john_mpmc_queue", false, mpmc_create, mpmc_destroy, mpmc_enqueue, mpmc_dequeue, NULL },
+        { "john_event_queue", false, event_create, event_destroy, event_enqueue, event_dequeue, NULL },
+        { "john_frame_queue", false, frame_create, frame_destroy, frame_enqueue, frame_dequeue, NULL },
+        { "john_spsc_ring_buffer", true, spsc_create, spsc_destroy, spsc_enqueue, spsc_dequeue, NULL },
+        { "john_byte_ring_buffer", true, byte_create, byte_destroy, byte_enqueue, byte_dequeue, byte_release },
+};
+
+/************************* pools *************************/
+
+static void *malloc_create(uint32_t capacity, uint32_t element_size) {
+    return (void *) 1; /* nothing to create, but NULL means failure */
+}
+
+static void malloc_destroy(void *pool) {
+}
+
+static void *malloc_obtain(void *pool, uint32_t element_size, void **block) {
+    return *block = malloc(element_size);
+}
+
+static void malloc_release(void *pool, void *handle) {
+    free(handle);
+}
+
+static uint32_t object_element_size;
+
+static void *object_create_func(void *user_client_params) {
+    return malloc(object_element_size);
+}
+
+static void *object_create(uint32_t capacity, uint32_t element_size) {
+    object_element_size = element_size;
+    JohnObjectDelegate delegate = { NULL, object_create_func, NULL, NULL };
+    return john_object_pool_create(UINT32_MAX, capacity, 0, &delegate);
+}
+
+static void object_destroy(void *pool) {
+    john_object_pool_destroy((JohnObjectPool *) pool);
+}
+
+static void *object_obtain(void *pool, uint32_t element_size, void **block) {
+    return *block = john_object_pool_obtain((JohnObjectPool *) pool);
+}
+
+static void object_release(void *pool, void *handle) {
+    john_object_pool_recycle((JohnObjectPool *) pool, handle);
+}
+
+static void *slab_create(uint32_t capacity, uint32_t element_size) {
+    return john_slab_arena_create(element_size, element_size, capacity);
+}
+
+static void slab_destroy(void *pool) {
+    john_slab_arena_destroy((JohnSlabArena *) pool);
+}
+
+static void *slab_obtain(void *pool, uint32_t element_size, void **block) {
+    JohnSlice *slice = john_slab_arena_alloc((JohnSlabArena *) pool, element_size);
+    *block = slice ? slice->data : NULL;
+    return slice;
+}
+
+static void slab_release(void *pool, void *handle) {
+    john_slice_release((JohnSlice *) handle);
+}
+
+static const BenchPool bench_pools[] = {
+        { "malloc", malloc_create, malloc_destroy, malloc_obtain, malloc_release },
+        { "john_object_pool", object_create, object_destroy, object_obtain, object_release },
+        { "john_slab_arena", slab_create, slab_destroy, slab_obtain, slab_release },
+};
+
+/************************* scenarios *************************/
+
+typedef struct HandoffContext {
+    const BenchQueue *bench_queue;
+    void *queue;
+    const BenchOptions *options;
+    uint32_t stride;
+    atomic_int producers_running;
+} HandoffContext;
+
+typedef struct ThreadContext {
+    HandoffContext *handoff;
+    const BenchPool *bench_pool;
+    void *pool;
+    uint8_t *elements;
+    uint64_t operations;
+    uint64_t checksum;
+    Histogram histogram;
+} ThreadContext;
+
+static void *do_produce(void *client) {
+    ThreadContext *context = (ThreadContext *) client;
+    HandoffContext *handoff = context->handoff;
+    uint32_t element_size = handoff->options->element_size;
+    for (uint32_t i = 0; i < handoff->options->operations; ++i) {
+        BenchElement *element = (BenchElement *) (context->elements + (size_t) i * handoff->stride);
+        memset(element + 1, (int) i, element_size - sizeof(BenchElement));
+        element->sequence = i;
+        element->stamp_nanos = now_nanos();
+        handoff->bench_queue->enqueue(handoff->queue, element, element_size);
+    }
+    atomic_fetch_sub(&handoff->producers_running, 1);
+    return NULL;
+}
+
+static void *do_consume(void *client) {
+    ThreadContext *context = (ThreadContext *) client;
+    HandoffContext *handoff = context->handoff;
+    uint32_t element_size = handoff->options->element_size;
+    while (true) {
+        bool finished = atomic_load(&handoff->producers_running) == 0;
+        BenchElement *element = handoff->bench_queue->dequeue(handoff->queue, element_size, CONSUMER_POLL_MILLIS);
+        if (!element) {
+            if (finished) {
+                break;
+            }
+            continue;
+        }
+        histogram_record(&context->histogram, now_nanos() - element->stamp_nanos);
+        const uint8_t *bytes = (const uint8_t *) element;
+        for (uint32_t i = sizeof(BenchElement); i < element_size; i += 8) {
+            context->checksum += bytes[i];
+        }
+        if (handoff->bench_queue->release) {
+            handoff->bench_queue->release(handoff->queue, element, element_size);
+        }
+        ++context->operations;
+    }
+    return NULL;
+}
+
+static bool run_handoff(const BenchQueue *bench_queue, int producers, int consumers, const BenchOptions *options,
+                        BenchResult *result) {
+    pthread_t producer_threads[MAX_THREADS], consumer_threads[MAX_THREADS];
+    ThreadContext *contexts = (ThreadContext *) calloc((size_t) (producers + consumers), sizeof(ThreadContext));
+    HandoffContext handoff = { bench_queue, bench_queue->create(options->capacity, options->element_size), options,
+                               (options->element_size + 15) & ~15U };
+    atomic_init(&handoff.producers_running, producers);
+    bool success = contexts && handoff.queue;
+    for (int i = 0; success && i < producers; ++i) {
+        contexts[i].handoff = &handoff;
+        contexts[i].elements = (uint8_t *) malloc((size_t) handoff.stride * options->operations);
+        success = contexts[i].elements != NULL;
+    }
+    for (int i = producers; success && i < producers + consumers; ++i) {
+        contexts[i].handoff = &handoff;
+    }
+    if (success) {
+        CacheCounter counter;
+        atomic_store(&dropped_count, 0);
+        cache_counter_start(&counter);
+        uint64_t begin = now_nanos();
+        for (int i = 0; i < consumers; ++i) {
+            pthread_create(&consumer_threads[i], NULL, do_consume, &contexts[producers + i]);
+        }
+        for (int i = 0; i < producers; ++i) {
+            pthread_create(&producer_threads[i], NULL, do_produce, &contexts[i]);
+        }
+        for (int i = 0; i < producers; ++i) {
+            pthread_join(producer_threads[i], NULL);
+        }
+        for (int i = 0; i < consumers; ++i) {
+            pthread_join(consumer_threads[i], NULL);
+        }
+        result->seconds = (double) (now_nanos() - begin) / 1e9;
+        result->cache_misses = cache_counter_stop(&counter);
+        result->dropped = atomic_load(&dropped_count);
+        for (int i = producers; i < producers + consumers; ++i) {
+            result->operations += contexts[i].operations;
+            histogram_merge(&result->histogram, &contexts[i].histogram);
+        }
+    }
+    if (handoff.queue) {
+        bench_queue->destroy(handoff.queue);
+    }
+    for (int i = 0; contexts && i < producers; ++i) {
+        free(contexts[i].elements);
+    }
+    free(contexts);
+    return success;
+}
+
+static void *do_churn(void *client) {
+    ThreadContext *context = (ThreadContext *) client;
+    uint32_t element_size = context->handoff->options->element_size;
+    void *handles[POOL_BATCH];
+    void *block;
+    uint32_t operations = context->handoff->options->operations;
+    for (uint32_t done = 0; done < operations; done += POOL_BATCH) {
+        uint32_t batch = operations - done < POOL_BATCH ? operations - done : POOL_BATCH;
+        uint64_t begin = now_nanos();
+        for (uint32_t i = 0; i < batch; ++i) {
+            handles[i] = context->bench_pool->obtain(context->pool, element_size, &block);
+            if (block) {
+                memset(block, (int) i, element_size);
+            }
+        }
+        for (uint32_t i = 0; i < batch; ++i) {
+            if (handles[i]) {
+                context->bench_pool->release(context->pool, handles[i]);
+            }
+        }
+        /* one sample per obtain/release pair */
+        histogram_record(&context->histogram, (now_nanos() - begin) / batch);
+        context->operations += batch;
+    }
+    if (context->bench_pool->release == object_release) {
+        john_object_pool_flush_thread_cache((JohnObjectPool *) context->pool);
+    }
+    return NULL;
+}
+
+static bool run_pool(const BenchPool *bench_pool, int threads, const BenchOptions *options, BenchResult *result) {
+    pthread_t thread_ids[MAX_THREADS];
+    ThreadContext contexts[MAX_THREADS];
+    HandoffContext handoff = { NULL, NULL, options, 0 };
+    void *pool = bench_pool->create(options->capacity, options->element_size);
+    if (!pool) {
+        return false;
+    }
+    memset(contexts, 0, sizeof(contexts));
+    CacheCounter counter;
+    cache_counter_start(&counter);
+    uint64_t begin = now_nanos();
+    for (int i = 0; i < threads; ++i) {
+        contexts[i].handoff = &handoff;
+        contexts[i].bench_pool = bench_pool;
+        contexts[i].pool = pool;
+        pthread_create(&thread_ids[i], NULL, do_churn, &contexts[i]);
+    }
+    for (int i = 0; i < threads; ++i) {
+        pthread_join(thread_ids[i], NULL);
+        result->operations += contexts[i].operations;
+        histogram_merge(&result->histogram, &contexts[i].histogram);
+    }
+    result->seconds = (double) (now_nanos() - begin) / 1e9;
+    result->cache_misses = cache_counter_stop(&counter);
+    bench_pool->destroy(pool);
+    return true;
+}
+
+typedef struct WorkerContext {
+    JohnWorkerPool *worker_pool;
+    uint8_t *elements;
+    uint32_t stride;
+    uint32_t operations;
+    Histogram *histograms; /* one per worker */
+    uint64_t *completed;   /* one per worker */
+} WorkerContext;
+
+static WorkerContext worker_context;
+
+static void do_worker_task(void *params) {
+    BenchElement *element = (BenchElement *) params;
+    int32_t index = john_worker_pool_current_index(worker_context.worker_pool);
+    histogram_record(&worker_context.histograms[index], now_nanos() - element->stamp_nanos);
+    ++worker_context.completed[index];
+}
+
+static void *do_submit(void *client) {
+    uint8_t *elements = (uint8_t *) client;
+    for (uint32_t i = 0; i < worker_context.operations; ++i) {
+        BenchElement *element = (BenchElement *) (elements + (size_t) i * worker_context.stride);
+        element->sequence = i;
+        element->stamp_nanos = now_nanos();
+        john_worker_pool_submit(worker_context.worker_pool, do_worker_task, element);
+    }
+    return NULL;
+}
+
+static bool run_worker_pool(int producers, int workers, const BenchOptions *options, BenchResult *result) {
+    pthread_t thread_ids[MAX_THREADS];
+    bool success = true;
+    memset(&worker_context, 0, sizeof(worker_context));
+    worker_context.stride = (options->element_size + 15) & ~15U;
+    worker_context.operations = options->operations;
+    worker_context.histograms = (Histogram *) calloc((size_t) workers, sizeof(Histogram));
+    worker_context.completed = (uint64_t *) calloc((size_t) workers, sizeof(uint64_t));
+    worker_context.elements = (uint8_t *) malloc((size_t) worker_context.stride * options->operations * producers);
+    if (!worker_context.histograms || !worker_context.completed || !worker_context.elements) {
+        success = false;
+        goto done;
+    }
+    CacheCounter counter;
+    cache_counter_start(&counter);
+    uint64_t begin = now_nanos();
+    if (!(worker_context.worker_pool = john_worker_pool_create((uint32_t) workers))) {
+        cache_counter_stop(&counter);
+        success = false;
+        goto done;
+    }
+    for (int i = 0; i < producers; ++i) {
+        pthread_create(&thread_ids[i], NULL, do_submit,
+                       worker_context.elements + (size_t) i * worker_context.stride * options->operations);
+    }
+    for (int i = 0; i < producers; ++i) {
+        pthread_join(thread_ids[i], NULL);
+    }
+    john_worker_pool_wait_idle(worker_context.worker_pool);
+    result->seconds = (double) (now_nanos() - begin) / 1e9;
+    result->cache_misses = cache_counter_stop(&counter);
+    john_worker_pool_destroy(worker_context.worker_pool);
+    for (int i = 0; i < workers; ++i) {
+        result->operations += worker_context.completed[i];
+        histogram_merge(&result->histogram, &worker_context.histograms[i]);
+    }
+done:
+    free(worker_context.elements);
+    free(worker_context.completed);
+    free(worker_context.histograms);
+    return success;
+}
+
+/************************* output *************************/
+
+static void print_header(const BenchOptions *options) {
+    if (strcmp(options->format, "csv") == 0) {
+        printf("name,producers,consumers,element_size,capacity,operations,dropped,seconds,ops_per_sec,"
+               "p50_ns,p99_ns,p999_ns,max_ns,cache_misses\n");
+    } else if (strcmp(options->format, "json") == 0) {
+        printf("[");
+    } else {
+        printf("%-24s %9s %14s %10s %10s %10s %10s %14s\n",
+               "name", "threads", "ops/sec", "p50(ns)", "p99(ns)", "p99.9(ns)", "dropped", "cache-misses");
+    }
+}
+
+static void print_result(const BenchOptions *options, const BenchResult *result, bool first) {
+    double ops = result->seconds > 0 ? (double) result->operations / result->seconds : 0;
+    uint64_t p50 = histogram_percentile(&result->histogram, 0.5);
+    uint64_t p99 = histogram_percentile(&result->histogram, 0.99);
+    uint64_t p999 = histogram_percentile(&result->histogram, 0.999);
+    if (strcmp(options->format, "csv") == 0) {
+        printf("%s,%d,%d,%u,%u,%llu,%llu,%.6f,%.0f,%llu,%llu,%llu,%llu,%lld\n",
+               result->name, result->producers, result->consumers, options->element_size, options->capacity,
+               (unsigned long long) result->operations, (unsigned long long) result->dropped, result->seconds, ops,
+               (unsigned long long) p50, (unsigned long long) p99, (unsigned long long) p999,
+               (unsigned long long) result->histogram.max, (long long) result->cache_misses);
+    } else if (strcmp(options->format, "json") == 0) {
+        printf("%s\n  {\"name\": \"%s\", \"producers\": %d, \"consumers\": %d, \"element_size\": %u, "
+               "\"capacity\": %u, \"operations\": %llu, \"dropped\": %llu, \"seconds\": %.6f, "
+               "\"ops_per_sec\": %.0f, \"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, \"max_ns\": %llu, "
+               "\"cache_misses\": %lld}",
+               first ? "" : ",", result->name, result->producers, result->consumers, options->element_size,
+               options->capacity, (unsigned long long) result->operations, (unsigned long long) result->dropped,
+               result->seconds, ops, (unsigned long long) p50, (unsigned long long) p99, (unsigned long long) p999,
+               (unsigned long long) result->histogram.max, (long long) result->cache_misses);
+    } else {
+        char threads[32];
+        snprintf(threads, sizeof(threads), "%dP/%dC", result->producers, result->consumers);
+        printf("%-24s %9s %14.0f %10llu %10llu %10llu %10llu %14lld\n", result->name, threads, ops,
+               (unsigned long long) p50, (unsigned long long) p99, (unsigned long long) p999,
+               (unsigned long long) result->dropped, (long long) result->cache_misses);
+    }
+    fflush(stdout);
+}
+
+static void print_footer(const BenchOptions *options) {
+    if (strcmp(options->format, "json") == 0) {
+        printf("\n]\n");
+    }
+}
+
+static bool matches_filter(const char *filter, const char *name) {
+    if (!filter) {
+        return true;
+    }
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "%s", filter);
+    for (char *save = NULL, *token = strtok_r(buffer, ",", &save); token; token = strtok_r(NULL, ",", &save)) {
+        if (strstr(name, token)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int parse_counts(const char *text, int *counts, int max_count) {
+    int count = 0;
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "%s", text);
+    for (char *save = NULL, *token = strtok_r(buffer, ",", &save); token && count < max_count;
+         token = strtok_r(NULL, ",", &save)) {
+        int value = atoi(token);
+        if (value > 0 && value <= MAX_THREADS) {
+            counts[count++] = value;
+        }
+    }
+    return count;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "usage: %s [-n operations_per_producer] [-t symmetric_thread_counts] [-p producers] "
+                    "[-c consumers] [-s element_size] [-q capacity] [-b name_filter] [-f table|csv|json]\n", program);
+}
+
+int main(int argc, char **argv) {
+    BenchOptions options = { 200000, 64, 1024, NULL, "table" };
+    int thread_counts[16] = { 1, 2, 4, 8, 16 };
+    int thread_count_size = 5, producers = 0, consumers = 0, option;
+    while ((option = getopt(argc, argv, "n:t:p:c:s:q:b:f:h")) != -1) {
+        switch (option) {
+            case 'n':
+                options.operations = (uint32_t) strtoul(optarg, NULL, 10);
+                break;
+            case 't':
+                thread_count_size = parse_counts(optarg, thread_counts, 16);
+                break;
+            case 'p':
+                producers = atoi(optarg);
+                break;
+            case 'c':
+                consumers = atoi(optarg);
+                break;
+            case 's':
+                options.element_size = (uint32_t) strtoul(optarg, NULL, 10);
+                break;
+            case 'q':
+                options.capacity = (uint32_t) strtoul(optarg, NULL, 10);
+                break;
+            case 'b':
+                options.filter = optarg;
+                break;
+            case 'f':
+                options.format = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (options.element_size < sizeof(BenchElement)) {
+        options.element_size = sizeof(BenchElement);
+    }
+    if (producers > 0 || consumers > 0) {
+        if (producers <= 0 || consumers <= 0 || producers > MAX_THREADS || consumers > MAX_THREADS) {
+            usage(argv[0]);
+            return 1;
+        }
+        thread_count_size = 1;
+    }
+
+    bool first = true;
+    print_header(&options);
+    for (int t = 0; t < thread_count_size; ++t) {
+        int p = producers > 0 ? producers : thread_counts[t];
+        int c = consumers > 0 ? consumers : thread_counts[t];
+        for (size_t q = 0; q < sizeof(bench_queues) / sizeof(bench_queues[0]); ++q) {
+            if (!matches_filter(options.filter, bench_queues[q].name) ||
+                (bench_queues[q].single_producer_consumer && (p != 1 || c != 1))) {
+                continue;
+            }
+            BenchResult result;
+            memset(&result, 0, sizeof(result));
+            result.name = bench_queues[q].name;
+            result.producers = p;
+            result.consumers = c;
+            if (run_handoff(&bench_queues[q], p, c, &options, &result)) {
+                print_result(&options, &result, first);
+                first = false;
+            }
+        }
+        for (size_t b = 0; b < sizeof(bench_pools) / sizeof(bench_pools[0]); ++b) {
+            if (!matches_filter(options.filter, bench_pools[b].name)) {
+                continue;
+            }
+            BenchResult result;
+            memset(&result, 0, sizeof(result));
+            result.name = bench_pools[b].name;
+            result.producers = p;
+            if (run_pool(&bench_pools[b], p, &options, &result)) {
+                print_result(&options, &result, first);
+                first = false;
+            }
+        }
+        if (matches_filter(options.filter, "john_worker_pool")) {
+            BenchResult result;
+            memset(&result, 0, sizeof(result));
+            result.name = "john_worker_pool";
+            result.producers = p;
+            result.consumers = c;
+            if (run_worker_pool(p, c, &options, &result)) {
+                print_result(&options, &result, first);
+                first = false;
+            }
+        }
+    }
+    print_footer(&options);
+    return 0;
+}
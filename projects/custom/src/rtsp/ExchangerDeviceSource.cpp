@@ -19,23 +19,44 @@
  * @version 2017-11-10
  */
 #include <sys/time.h>
+#include <algorithm>
+#include <cstring>
 #include "ExchangerDeviceSource.hpp"
 #include "common.h"
 
-ExchangerDeviceSource *ExchangerDeviceSource::createNew(UsageEnvironment& env) {
-    return new ExchangerDeviceSource(env);
+ExchangerDeviceSource *ExchangerDeviceSource::createNew(UsageEnvironment& env, ExchangerDataDelegate *dataDelegate) {
+    return new ExchangerDeviceSource(env, dataDelegate);
+}
+
+ExchangerReadResult ExchangerDataDelegate::tryReadInto(ExchangerDeviceSource *source, uint8_t *to, uint32_t maxSize,
+                                                      ExchangerDelivery *delivery) {
+    uint8_t *data;
+    uint32_t dataSize;
+    ExchangerReadResult result = tryReadData(source, &data, &dataSize);
+    if (result == EXCHANGER_READ_OK) {
+        delivery->frameSize = std::min(dataSize, maxSize);
+        delivery->numTruncatedBytes = dataSize - delivery->frameSize;
+        memmove(to, data, delivery->frameSize);
+    }
+    return result;
 }
 
-ExchangerDataDelegate *ExchangerDeviceSource::dataDelegate = nullptr;
 unsigned ExchangerDeviceSource::referenceCount = 0;
+EventTriggerId ExchangerDeviceSource::eventTriggerId = 0;
+std::vector<ExchangerDeviceSource *> ExchangerDeviceSource::instances;
+pthread_mutex_t ExchangerDeviceSource::instancesMutex = PTHREAD_MUTEX_INITIALIZER;
 
-ExchangerDeviceSource::ExchangerDeviceSource(UsageEnvironment& env)
-        :FramedSource(env), errorHappened(false) {
+ExchangerDeviceSource::ExchangerDeviceSource(UsageEnvironment& env, ExchangerDataDelegate *dataDelegate)
+        :FramedSource(env), dataDelegate(dataDelegate), framePending(false), deliveryScheduled(false), lastEndsAccessUnit(false), errorHappened(false) {
     if (referenceCount == 0) {
         // Any global initialization of the device would be done here:
+        eventTriggerId = envir().taskScheduler().createEventTrigger(deliverPendingFrames);
     }
     ++referenceCount;
     // Any instance-specific initialization of the device would be done here:
+    pthread_mutex_lock(&instancesMutex);
+    instances.push_back(this);
+    pthread_mutex_unlock(&instancesMutex);
     if (dataDelegate) {
         dataDelegate->onOpen(this);
     }
@@ -43,12 +64,18 @@ ExchangerDeviceSource::ExchangerDeviceSource(UsageEnvironment& env)
 
 ExchangerDeviceSource::~ExchangerDeviceSource() {
     // Any instance-specific 'destruction' (i.e., resetting) of the device would be done here:
+    // unregister first, so that a producer still running inside onClose() can no longer signal us
+    pthread_mutex_lock(&instancesMutex);
+    instances.erase(std::remove(instances.begin(), instances.end(), this), instances.end());
+    pthread_mutex_unlock(&instancesMutex);
     if (dataDelegate) {
         dataDelegate->onClose(this);
     }
     --referenceCount;
     if (referenceCount == 0) {
         // Any global 'destruction' (i.e., resetting) of the device would be done here:
+        envir().taskScheduler().deleteEventTrigger(eventTriggerId);
+        eventTriggerId = 0;
     }
 }
 
@@ -56,8 +83,68 @@ void ExchangerDeviceSource::setErrorHappened(bool errorHappened) {
     this->errorHappened = errorHappened;
 }
 
+void ExchangerDeviceSource::startPlaying() {
+    if (dataDelegate) {
+        dataDelegate->onStartPlaying(this);
+    }
+}
+
+void ExchangerDeviceSource::signalNewFrame(ExchangerDeviceSource *source) {
+    pthread_mutex_lock(&instancesMutex);
+    if (std::find(instances.begin(), instances.end(), source) != instances.end()) {
+        source->framePending = true;
+        // triggerEvent() is the one live555 call that is safe from another thread
+        source->envir().taskScheduler().triggerEvent(eventTriggerId, nullptr);
+    }
+    pthread_mutex_unlock(&instancesMutex);
+}
+
+void ExchangerDeviceSource::signalNewFrames(ExchangerDataDelegate *dataDelegate) {
+    pthread_mutex_lock(&instancesMutex);
+    ExchangerDeviceSource *signalled = nullptr;
+    for (ExchangerDeviceSource *source : instances) {
+        if (source->dataDelegate == dataDelegate) {
+            source->framePending = true;
+            signalled = source;
+        }
+    }
+    if (signalled) {
+        // one trigger wakes deliverPendingFrames(), which serves every pending source
+        signalled->envir().taskScheduler().triggerEvent(eventTriggerId, nullptr);
+    }
+    pthread_mutex_unlock(&instancesMutex);
+}
+
+void ExchangerDeviceSource::deliverPendingFrames(void *clientData) {
+    // runs on the event loop thread, the same thread that destroys instances: a source found registered
+    // right before its call stays alive through it
+    std::vector<ExchangerDeviceSource *> pending;
+    pthread_mutex_lock(&instancesMutex);
+    for (ExchangerDeviceSource *source : instances) {
+        if (source->framePending.exchange(false)) {
+            pending.push_back(source);
+        }
+    }
+    pthread_mutex_unlock(&instancesMutex);
+    for (ExchangerDeviceSource *source : pending) {
+        // serving one source may close and destroy another (e.g. through handleClosure()), it is skipped then
+        if (isRegistered(source) && source->isCurrentlyAwaitingData()) {
+            source->doGetNextFrame();
+        }
+    }
+}
+
+bool ExchangerDeviceSource::isRegistered(ExchangerDeviceSource *source) {
+    pthread_mutex_lock(&instancesMutex);
+    bool registered = std::find(instances.begin(), instances.end(), source) != instances.end();
+    pthread_mutex_unlock(&instancesMutex);
+    return registered;
+}
+
 void ExchangerDeviceSource::doStopGettingFrames() {
     FramedSource::doStopGettingFrames();
+    // the afterDelivery task, if any, has just been unscheduled
+    deliveryScheduled = false;
 }
 
 void ExchangerDeviceSource::doGetNextFrame() {
@@ -65,29 +152,59 @@ void ExchangerDeviceSource::doGetNextFrame() {
         handleClosure();
         return;
     }
+    if (deliveryScheduled) {
+        // signalled again while a frame waits for its release time, it goes first
+        return;
+    }
 
-    uint8_t *data;
-    uint32_t dataSize;
-    if (dataDelegate->readDataSync(this, &data, &dataSize)) {
-        LOGW("peeked new data...\n");
-        deliverFrame(data, dataSize);
-    } else {
+    ExchangerBorrowedFrame borrowedFrame = ExchangerBorrowedFrame();
+    ExchangerReadResult result = dataDelegate->tryBorrowFrame(this, &borrowedFrame);
+    if (result == EXCHANGER_READ_OK) {
+        deliverBorrowedFrame(borrowedFrame);
+        return;
+    }
+    if (result == EXCHANGER_READ_UNSUPPORTED) {
+        ExchangerDelivery delivery = ExchangerDelivery();
+        result = dataDelegate->tryReadInto(this, fTo, fMaxSize, &delivery);
+        if (result == EXCHANGER_READ_OK) {
+            deliverFrame(delivery);
+            return;
+        }
+    }
+    if (result != EXCHANGER_READ_AGAIN) {
         handleClosure();
         return;
     }
 
     // No new data is immediately available to be delivered.  We don't do anything more here.
     // Instead, our event trigger must be called (e.g., from a separate thread) when new data becomes available.
+}
 
-    LOGW("waiting data...\n");
+void ExchangerDeviceSource::deliverBorrowedFrame(ExchangerBorrowedFrame &borrowedFrame) {
+    // the borrowed frame is copied into the 'downstream' object, so it goes back to the delegate right away
+    ExchangerDelivery delivery = ExchangerDelivery();
+    delivery.frameSize = std::min(borrowedFrame.dataSize, fMaxSize);
+    delivery.numTruncatedBytes = borrowedFrame.dataSize - delivery.frameSize;
+    delivery.presentationTime = borrowedFrame.presentationTime;
+    delivery.endsAccessUnit = borrowedFrame.endsAccessUnit;
+    delivery.durationInMicroseconds = borrowedFrame.durationInMicroseconds;
+    delivery.releaseInMicroseconds = borrowedFrame.releaseInMicroseconds;
+    memmove(fTo, borrowedFrame.data, delivery.frameSize);
+    dataDelegate->releaseFrame(this, &borrowedFrame);
+    deliverFrame(delivery);
 }
 
-void ExchangerDeviceSource::deliverFrame(uint8_t *data, uint32_t dataSize) {
-    // This function is called when new frame data is available from the device.
-    // We deliver this data by copying it to the 'downstream' object,
-    // using the following parameters (class members):
+void ExchangerDeviceSource::afterDelivery(void *clientData) {
+    auto *source = static_cast<ExchangerDeviceSource *>(clientData);
+    source->deliveryScheduled = false;
+    FramedSource::afterGetting(source);
+}
+
+void ExchangerDeviceSource::deliverFrame(const ExchangerDelivery &delivery) {
+    // This function is called when new frame data has been written to the 'downstream' object,
+    // and sets up the following parameters (class members):
     // 'in' parameters (these should *not* be modified by this function):
-    //     fTo: The frame data is copied to this address.
+    //     fTo: The frame data has been copied to this address.
     //         (Note that the variable "fTo" is *not* modified.  Instead,
     //          the frame data is copied to the address pointed to by "fTo".)
     //     fMaxSize: This is the maximum number of bytes that can be copied
@@ -107,26 +224,31 @@ void ExchangerDeviceSource::deliverFrame(uint8_t *data, uint32_t dataSize) {
     //         because - in this case - data will never arrive 'early'.
     // Note the code below.
 
-    if (!isCurrentlyAwaitingData()) return; // we're not ready for the data yet
-
-    if (dataSize <= 0) return;
+    if (!isCurrentlyAwaitingData() /* we're not ready for the data yet */
+        || (delivery.frameSize == 0 && delivery.numTruncatedBytes == 0)) {
+        return;
+    }
 
-    // Deliver the data here: fMaxSize[default=1456]
-    if (dataSize > fMaxSize) {
-        fFrameSize = fMaxSize;
-        fNumTruncatedBytes = dataSize - fMaxSize;
+    // The data is already at fTo: fMaxSize[default=1456]
+    fFrameSize = delivery.frameSize;
+    fNumTruncatedBytes = delivery.numTruncatedBytes;
+    lastEndsAccessUnit = delivery.endsAccessUnit;
+    if (delivery.presentationTime.tv_sec == 0 && delivery.presentationTime.tv_usec == 0) {
+        // the delegate had no more accurate time (e.g. from an encoder)
+        gettimeofday(&fPresentationTime, nullptr);
     } else {
-        fFrameSize = dataSize;
+        fPresentationTime = delivery.presentationTime;
     }
-    // If you have a more accurate time - e.g., from an encoder - then use that instead.
-    gettimeofday(&fPresentationTime, nullptr);
     // If the device is *not* a 'live source' (e.g., it comes instead from a file or buffer),
     // then set "fDurationInMicroseconds" here.
-    memmove(fTo, data, fFrameSize);
+    // A live delegate may know it too, from the capture clock of its frames.
+    fDurationInMicroseconds = delivery.durationInMicroseconds;
 
     // After delivering the data, inform the reader that it is now available:
-    // To avoid possible infinite recursion, we need to return to the event loop to do this:
+    // To avoid possible infinite recursion, we need to return to the event loop to do this,
+    // not before the release time of the frame:
+    deliveryScheduled = true;
     nextTask() = envir().taskScheduler()
-            .scheduleDelayedTask(0, (TaskFunc*)FramedSource::afterGetting, this);
+            .scheduleDelayedTask(delivery.releaseInMicroseconds, afterDelivery, this);
     LOGW("after getting data...\n");
 }
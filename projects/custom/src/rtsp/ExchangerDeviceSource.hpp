@@ -22,32 +22,91 @@
 #define _EXCHANGER_DEVICE_SOURCE_H
 
 #include <cstdint>
+#include <atomic>
+#include <sys/time.h>
+#include <vector>
+#include <pthread.h>
 #include "UsageEnvironment.hh"
 #include "FramedSource.hh"
 
 class ExchangerDeviceSource;
 
+enum ExchangerReadResult {
+    EXCHANGER_READ_OK,    // data and dataSize are set
+    EXCHANGER_READ_AGAIN, // nothing ready, the producer calls ExchangerDeviceSource::signalNewFrame() later
+    EXCHANGER_READ_CLOSED,
+    EXCHANGER_READ_UNSUPPORTED // the delegate does not lend frames, see tryBorrowFrame()
+};
+
+// what is handed to the downstream object, filled by tryReadInto()
+struct ExchangerDelivery {
+    uint32_t frameSize;
+    uint32_t numTruncatedBytes;
+    struct timeval presentationTime; // left {0, 0} to have the source stamp it with gettimeofday()
+    bool endsAccessUnit; // discrete NAL mode only: this NAL unit is the last one of its picture
+    unsigned durationInMicroseconds; // 0 if unknown, lets the RTP sink pace what follows
+    int64_t releaseInMicroseconds; // how long the frame is held back before it goes downstream, 0 for right away
+};
+
+// a pooled frame lent to the source, which copies it downstream and gives it back by releaseFrame() right after
+struct ExchangerBorrowedFrame {
+    uint8_t *data;
+    uint32_t dataSize;
+    struct timeval presentationTime; // left {0, 0} to have the source stamp it with gettimeofday()
+    bool endsAccessUnit; // see ExchangerDelivery
+    unsigned durationInMicroseconds; // see ExchangerDelivery
+    int64_t releaseInMicroseconds; // see ExchangerDelivery
+    void *handle; // opaque to the source, e.g. the JohnSlice holding data
+};
+
 class ExchangerDataDelegate {
 public:
     virtual void onOpen(ExchangerDeviceSource *source) = 0;
     virtual bool readDataSync(ExchangerDeviceSource *source, uint8_t **data, uint32_t *dataSize) = 0;
+    // called on the event loop thread, so it must not block;
+    // the default falls back to readDataSync() for delegates that always have data at hand (e.g. files)
+    virtual ExchangerReadResult tryReadData(ExchangerDeviceSource *source, uint8_t **data, uint32_t *dataSize) {
+        return readDataSync(source, data, dataSize) ? EXCHANGER_READ_OK : EXCHANGER_READ_CLOSED;
+    }
+    // writes the next frame straight into the downstream buffer (fTo, fMaxSize), same threading rule as tryReadData();
+    // the default copies what tryReadData() returns, so override it to save that copy (e.g. fread into 'to')
+    virtual ExchangerReadResult tryReadInto(ExchangerDeviceSource *source, uint8_t *to, uint32_t maxSize,
+                                            ExchangerDelivery *delivery);
+    // borrowed-buffer mode, tried before tryReadInto(): lends a frame the source copies downstream without
+    // the delegate copying it out first; every frame lent with EXCHANGER_READ_OK comes back through releaseFrame()
+    // before the source borrows the next one
+    virtual ExchangerReadResult tryBorrowFrame(ExchangerDeviceSource *source, ExchangerBorrowedFrame *frame) {
+        return EXCHANGER_READ_UNSUPPORTED;
+    }
+    virtual void releaseFrame(ExchangerDeviceSource *source, ExchangerBorrowedFrame *frame) { }
+    // the client of source has sent PLAY, before its first frame is asked for (e.g. to burst a cached GOP)
+    virtual void onStartPlaying(ExchangerDeviceSource *source) { }
+    // the H.264 SPS and PPS without start codes if known before the first frame (e.g. from the encoder headers),
+    // so DESCRIBE is answered without reading the stream; called on the event loop thread
+    virtual bool getParameterSets(std::vector<uint8_t> &sps, std::vector<uint8_t> &pps) { return false; }
     virtual void onClose(ExchangerDeviceSource *source) = 0;
     virtual ~ExchangerDataDelegate() = default;
 };
 
 class ExchangerDeviceSource: public FramedSource {
 public:
-    static ExchangerDeviceSource *createNew(UsageEnvironment& env);
-
-public:
-    static ExchangerDataDelegate *dataDelegate;
+    // dataDelegate is not owned, every stream has its own
+    static ExchangerDeviceSource *createNew(UsageEnvironment& env, ExchangerDataDelegate *dataDelegate);
 
 public:
     void setErrorHappened(bool errorHappened);
+    // may be called from any thread, e.g. the encoder thread right after a frame is queued
+    static void signalNewFrame(ExchangerDeviceSource *source);
+    // same, for every source fed by dataDelegate (e.g. all clients of one live stream)
+    static void signalNewFrames(ExchangerDataDelegate *dataDelegate);
+    // called by the subsession on PLAY, see ExchangerDataDelegate::onStartPlaying()
+    void startPlaying();
+    // whether the frame delivered last ends its access unit, for the discrete NAL framer
+    bool lastFrameEndsAccessUnit() const { return lastEndsAccessUnit; }
 
 protected:
     // called only by createNew(), or by subclass constructors
-    explicit ExchangerDeviceSource(UsageEnvironment& env);
+    ExchangerDeviceSource(UsageEnvironment& env, ExchangerDataDelegate *dataDelegate);
     ~ExchangerDeviceSource() override;
 
 private:
@@ -56,10 +115,23 @@ private:
     void doGetNextFrame() override;
 
 private:
-    void deliverFrame(uint8_t *data, uint32_t dataSize);
+    void deliverFrame(const ExchangerDelivery &delivery);
+    void deliverBorrowedFrame(ExchangerBorrowedFrame &borrowedFrame);
+    static void afterDelivery(void *clientData);
+    static void deliverPendingFrames(void *clientData);
+    static bool isRegistered(ExchangerDeviceSource *source);
 
 private:
     static unsigned referenceCount; // used to count how many instances of this class currently exist
+    // live555 offers only 32 event triggers per scheduler, so all instances share one and
+    // the trigger handler looks up which of them have been signalled
+    static EventTriggerId eventTriggerId;
+    static std::vector<ExchangerDeviceSource *> instances; // guarded by instancesMutex
+    static pthread_mutex_t instancesMutex;
+    ExchangerDataDelegate *dataDelegate;
+    std::atomic<bool> framePending;
+    bool deliveryScheduled; // the frame is at fTo, afterDelivery() is due (possibly held back, see ExchangerDelivery)
+    bool lastEndsAccessUnit;
     bool errorHappened;
 };
 
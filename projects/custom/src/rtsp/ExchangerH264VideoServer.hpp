@@ -22,6 +22,7 @@
 #define EXCHANGER_H264_VIDEO_SERVER_H
 
 #include <unistd.h>
+#include <algorithm>
 #include "ExchangerDeviceSource.hpp"
 #include "ExchangerH264VideoServerMediaSubsession.hpp"
 #include "BasicUsageEnvironment.hh"
@@ -57,6 +58,19 @@ public:
         return false;
     }
 
+    ExchangerReadResult tryReadInto(ExchangerDeviceSource *source, uint8_t *to, uint32_t maxSize,
+                                    ExchangerDelivery *delivery) override {
+        // the framer parses a byte stream, so reading straight into its buffer never truncates
+        if (file && !feof(file)) {
+            size_t readedCount = fread(to, sizeof(uint8_t), std::min<size_t>(maxSize, bufferSize), file);
+            if (readedCount > 0) {
+                delivery->frameSize = static_cast<uint32_t>(readedCount);
+                return EXCHANGER_READ_OK;
+            }
+        }
+        return EXCHANGER_READ_CLOSED;
+    }
+
     void onClose(ExchangerDeviceSource *source) override {
         if (file) {
             LOGW("onClose\n");
@@ -75,11 +89,11 @@ static void ExchangerH264VideoServer_doRtsp() {
     UsageEnvironment *environment = BasicUsageEnvironment::createNew(*scheduler);
     RTSPServer *rtspServer = RTSPServer::createNew(*environment, 8554);
 
-    ExchangerDeviceSource::dataDelegate = new SimpleDataDelegate(
+    ExchangerDataDelegate *dataDelegate = new SimpleDataDelegate(
             "data/test.264", 1024);
 
     ServerMediaSession *sms = ServerMediaSession::createNew(*environment, "testH264", "testH264");
-    sms->addSubsession(ExchangerH264VideoServerMediaSubsession::createNew(*environment, False));
+    sms->addSubsession(ExchangerH264VideoServerMediaSubsession::createNew(*environment, False, dataDelegate));
     rtspServer->addServerMediaSession(sms);
 
     char* url = rtspServer->rtspURL(sms);
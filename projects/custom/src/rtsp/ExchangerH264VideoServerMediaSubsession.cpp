@@ -20,13 +20,18 @@
  */
 #include "ExchangerH264VideoServerMediaSubsession.hpp"
 #include "ExchangerDeviceSource.hpp"
+#include "ExchangerH264VideoStreamDiscreteFramer.hpp"
 #include "H264VideoRTPSink.hh"
 #include "H264VideoStreamFramer.hh"
 
 ExchangerH264VideoServerMediaSubsession::ExchangerH264VideoServerMediaSubsession(UsageEnvironment &env,
-                                                                                 const Boolean &reuseFirstSource)
+                                                                                 const Boolean &reuseFirstSource,
+                                                                                 ExchangerDataDelegate *dataDelegate,
+                                                                                 const Boolean &discreteNals)
         : OnDemandServerMediaSubsession(env, reuseFirstSource),
-          fAuxSDPLine(nullptr), fDoneFlag(0), fDummyRTPSink(nullptr) {
+          fAuxSDPLine(nullptr), fDoneFlag(0), fDummyRTPSink(nullptr), fDataDelegate(dataDelegate),
+          fSharedSource(reuseFirstSource), fDiscreteNals(discreteNals),
+          fRateController(nullptr) {
 }
 
 ExchangerH264VideoServerMediaSubsession::~ExchangerH264VideoServerMediaSubsession() {
@@ -35,8 +40,10 @@ ExchangerH264VideoServerMediaSubsession::~ExchangerH264VideoServerMediaSubsessio
 
 ExchangerH264VideoServerMediaSubsession *
 ExchangerH264VideoServerMediaSubsession::createNew(UsageEnvironment &env,
-                                                   const Boolean &reuseFirstSource) {
-    return new ExchangerH264VideoServerMediaSubsession(env, reuseFirstSource);
+                                                   const Boolean &reuseFirstSource,
+                                                   ExchangerDataDelegate *dataDelegate,
+                                                   const Boolean &discreteNals) {
+    return new ExchangerH264VideoServerMediaSubsession(env, reuseFirstSource, dataDelegate, discreteNals);
 }
 
 static void
@@ -81,11 +88,34 @@ ExchangerH264VideoServerMediaSubsession::checkForAuxSDPLine1() {
     }
 }
 
+char const *
+ExchangerH264VideoServerMediaSubsession::sdpLines() {
+    std::vector<uint8_t> sps, pps;
+    if (fDataDelegate != nullptr && fDataDelegate->getParameterSets(sps, pps)
+        && (sps != fAuxSPS || pps != fAuxPPS)) {
+        // a new encoder (e.g. at another resolution tier) has new parameter sets, so the lines are built again
+        // from a sink given these, see createNewRTPSink()
+        delete[] fSDPLines;
+        fSDPLines = nullptr;
+        delete[] fAuxSDPLine;
+        fAuxSDPLine = nullptr;
+        fAuxSPS.swap(sps);
+        fAuxPPS.swap(pps);
+    }
+    return OnDemandServerMediaSubsession::sdpLines();
+}
+
 char const *
 ExchangerH264VideoServerMediaSubsession::getAuxSDPLine(RTPSink *rtpSink,
                                                        FramedSource *inputSource) {
     if (fAuxSDPLine != nullptr) return fAuxSDPLine; // it's already been set up (for a previous client)
 
+    char const* dasl = rtpSink->auxSDPLine();
+    if (dasl != nullptr) { // the sink was given the SPS and PPS of the delegate, see createNewRTPSink()
+        fAuxSDPLine = strDup(dasl);
+        return fAuxSDPLine;
+    }
+
     if (fDummyRTPSink == nullptr) { // we're not already setting it up for another, concurrent stream
         // Note: For H264 video files, the 'config' information ("profile-level-id" and "sprop-parameter-sets") isn't known
         // until we start reading the file.  This means that "rtpSink"s "auxSDPLine()" will be nullptr initially,
@@ -109,12 +139,53 @@ FramedSource *
 ExchangerH264VideoServerMediaSubsession::createNewStreamSource(unsigned clientSessionId,
                                                                unsigned &estBitrate) {
     estBitrate = 500; // kbps, estimate
-    return H264VideoStreamFramer::createNew(envir(), ExchangerDeviceSource::createNew(envir()));
+    // session id 0 is the source sdpLines() probes; when the delegate knows the parameter sets it is never read,
+    // so it gets no delegate and starts no producer
+    std::vector<uint8_t> sps, pps;
+    bool probeOnly = clientSessionId == 0 && fDataDelegate != nullptr && fDataDelegate->getParameterSets(sps, pps);
+    ExchangerDeviceSource *source = ExchangerDeviceSource::createNew(envir(), probeOnly ? nullptr : fDataDelegate);
+    if (fDiscreteNals) {
+        return ExchangerH264VideoStreamDiscreteFramer::createNew(envir(), source);
+    }
+    return H264VideoStreamFramer::createNew(envir(), source);
 }
 
 RTPSink *
 ExchangerH264VideoServerMediaSubsession::createNewRTPSink(Groupsock *rtpGroupsock,
                                                           unsigned char rtpPayloadTypeIfDynamic,
                                                           FramedSource *inputSource) {
+    std::vector<uint8_t> sps, pps;
+    if (fDataDelegate != nullptr && fDataDelegate->getParameterSets(sps, pps)) {
+        // auxSDPLine() is ready right away, with no frame read from inputSource
+        return H264VideoRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic,
+                                           sps.data(), static_cast<unsigned>(sps.size()),
+                                           pps.data(), static_cast<unsigned>(pps.size()));
+    }
     return H264VideoRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic);
 }
+
+RTCPInstance *
+ExchangerH264VideoServerMediaSubsession::createRTCP(Groupsock *RTCPgs, unsigned totSessionBW,
+                                                    unsigned char const *cname, RTPSink *sink) {
+    if (fRateController == nullptr) {
+        return OnDemandServerMediaSubsession::createRTCP(RTCPgs, totSessionBW, cname, sink);
+    }
+    return ExchangerRTCPInstance::createNew(envir(), RTCPgs, totSessionBW, cname, sink, fRateController);
+}
+
+void ExchangerH264VideoServerMediaSubsession::startStream(unsigned clientSessionId, void *streamToken,
+                                                          TaskFunc *rtcpRRHandler, void *rtcpRRHandlerClientData,
+                                                          unsigned short &rtpSeqNum, unsigned &rtpTimestamp,
+                                                          ServerRequestAlternativeByteHandler *serverRequestAlternativeByteHandler,
+                                                          void *serverRequestAlternativeByteHandlerClientData) {
+    auto *streamState = static_cast<StreamState *>(streamToken);
+    // a shared source already plays for the clients before this one
+    if (!fSharedSource && streamState != nullptr && streamState->mediaSource() != nullptr) {
+        // the framer wraps the device source, see createNewStreamSource()
+        auto *framer = static_cast<FramedFilter *>(streamState->mediaSource());
+        static_cast<ExchangerDeviceSource *>(framer->inputSource())->startPlaying();
+    }
+    OnDemandServerMediaSubsession::startStream(clientSessionId, streamToken, rtcpRRHandler, rtcpRRHandlerClientData,
+                                               rtpSeqNum, rtpTimestamp, serverRequestAlternativeByteHandler,
+                                               serverRequestAlternativeByteHandlerClientData);
+}
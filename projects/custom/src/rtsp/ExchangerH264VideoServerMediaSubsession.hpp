@@ -21,22 +21,36 @@
 #ifndef EXCHANGER_H264_VIDEO_SERVER_MEDIA_SUBSESSION_H
 #define EXCHANGER_H264_VIDEO_SERVER_MEDIA_SUBSESSION_H
 
+#include <cstdint>
+#include <vector>
 #include "OnDemandServerMediaSubsession.hh"
 #include "UsageEnvironment.hh"
+#include "ExchangerRateController.hpp"
+#include "ExchangerDeviceSource.hpp"
 
 class ExchangerH264VideoServerMediaSubsession: public OnDemandServerMediaSubsession {
 public:
-    static ExchangerH264VideoServerMediaSubsession *createNew(UsageEnvironment &env, const Boolean &reuseFirstSource);
+    // discreteNals: the data delegate lends one NAL unit (without start code) per frame and marks the access unit ends,
+    // so no Annex-B byte stream has to be parsed
+    // dataDelegate: feeds every source of this subsession (one live stream); not owned
+    static ExchangerH264VideoServerMediaSubsession *createNew(UsageEnvironment &env, const Boolean &reuseFirstSource,
+                                                              ExchangerDataDelegate *dataDelegate,
+                                                              const Boolean &discreteNals = False);
+    // receiver reports of every client are fed to it from then on; not owned
+    void setRateController(ExchangerRateController *rateController) { fRateController = rateController; }
     // Used to implement "getAuxSDPLine()":
     void checkForAuxSDPLine1();
     void afterPlayingDummy1();
 protected:
-    ExchangerH264VideoServerMediaSubsession(UsageEnvironment &env, const Boolean &reuseFirstSource);
+    ExchangerH264VideoServerMediaSubsession(UsageEnvironment &env, const Boolean &reuseFirstSource,
+                                            ExchangerDataDelegate *dataDelegate, const Boolean &discreteNals);
     ~ExchangerH264VideoServerMediaSubsession() override;
 
     void setDoneFlag() { fDoneFlag = ~0; }
 
 protected: // redefined virtual functions
+    // drops the SDP lines built for other parameter sets, e.g. of the encoder before a resolution tier change
+    char const* sdpLines() override;
     char const* getAuxSDPLine(RTPSink* rtpSink,
                                       FramedSource* inputSource) override;
     FramedSource* createNewStreamSource(unsigned clientSessionId,
@@ -44,10 +58,23 @@ protected: // redefined virtual functions
     RTPSink* createNewRTPSink(Groupsock* rtpGroupsock,
                                       unsigned char rtpPayloadTypeIfDynamic,
                                       FramedSource* inputSource) override;
+    RTCPInstance* createRTCP(Groupsock* RTCPgs, unsigned totSessionBW,
+                             unsigned char const* cname, RTPSink* sink) override;
+    // lets the device source of the client know it plays now, so its delegate can burst the cached GOP
+    void startStream(unsigned clientSessionId, void* streamToken, TaskFunc* rtcpRRHandler,
+                     void* rtcpRRHandlerClientData, unsigned short& rtpSeqNum, unsigned& rtpTimestamp,
+                     ServerRequestAlternativeByteHandler* serverRequestAlternativeByteHandler,
+                     void* serverRequestAlternativeByteHandlerClientData) override;
 private:
     char* fAuxSDPLine;
     char fDoneFlag; // used when setting up "fAuxSDPLine"
+    std::vector<uint8_t> fAuxSPS; // of the delegate when "fAuxSDPLine" was set up
+    std::vector<uint8_t> fAuxPPS; // ditto
     RTPSink* fDummyRTPSink; // ditto
+    ExchangerDataDelegate* fDataDelegate;
+    Boolean fSharedSource; // reuseFirstSource, private to OnDemandServerMediaSubsession
+    Boolean fDiscreteNals;
+    ExchangerRateController* fRateController;
 };
 
 #endif // EXCHANGER_H264_VIDEO_SERVER_MEDIA_SUBSESSION_H
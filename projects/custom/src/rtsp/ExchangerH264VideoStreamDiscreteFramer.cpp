@@ -0,0 +1,38 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#include "ExchangerH264VideoStreamDiscreteFramer.hpp"
+
+ExchangerH264VideoStreamDiscreteFramer *
+ExchangerH264VideoStreamDiscreteFramer::createNew(UsageEnvironment &env, ExchangerDeviceSource *inputSource) {
+    return new ExchangerH264VideoStreamDiscreteFramer(env, inputSource);
+}
+
+ExchangerH264VideoStreamDiscreteFramer::ExchangerH264VideoStreamDiscreteFramer(UsageEnvironment &env,
+                                                                               ExchangerDeviceSource *inputSource)
+        : H264VideoStreamDiscreteFramer(env, inputSource), deviceSource(inputSource) {
+}
+
+ExchangerH264VideoStreamDiscreteFramer::~ExchangerH264VideoStreamDiscreteFramer() = default;
+
+Boolean ExchangerH264VideoStreamDiscreteFramer::nalUnitEndsAccessUnit(u_int8_t nal_unit_type) {
+    // called right after the NAL unit has been delivered, so the source still knows about it
+    return deviceSource->lastFrameEndsAccessUnit() ? True : False;
+}
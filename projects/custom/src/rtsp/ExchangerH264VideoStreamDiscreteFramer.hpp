@@ -0,0 +1,43 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Takes one NAL unit (without start code) per frame from an ExchangerDeviceSource,
+ * and ends the RTP picture where the delegate says the access unit ends,
+ * instead of guessing it from the NAL unit type.
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#ifndef EXCHANGER_H264_VIDEO_STREAM_DISCRETE_FRAMER_H
+#define EXCHANGER_H264_VIDEO_STREAM_DISCRETE_FRAMER_H
+
+#include "H264VideoStreamDiscreteFramer.hh"
+#include "ExchangerDeviceSource.hpp"
+
+class ExchangerH264VideoStreamDiscreteFramer: public H264VideoStreamDiscreteFramer {
+public:
+    static ExchangerH264VideoStreamDiscreteFramer *createNew(UsageEnvironment &env, ExchangerDeviceSource *inputSource);
+protected:
+    ExchangerH264VideoStreamDiscreteFramer(UsageEnvironment &env, ExchangerDeviceSource *inputSource);
+    ~ExchangerH264VideoStreamDiscreteFramer() override;
+
+protected: // redefined virtual functions
+    Boolean nalUnitEndsAccessUnit(u_int8_t nal_unit_type) override;
+private:
+    ExchangerDeviceSource *deviceSource;
+};
+
+#endif // EXCHANGER_H264_VIDEO_STREAM_DISCRETE_FRAMER_H
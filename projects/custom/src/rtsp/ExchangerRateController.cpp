@@ -0,0 +1,174 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#include <algorithm>
+#include "ExchangerRateController.hpp"
+#include "RTPSink.hh"
+#include "common.h"
+
+static const double HEAVY_LOSS = 0.10; // cut by DECREASE_FACTOR above this
+static const double LIGHT_LOSS = 0.02; // hold between LIGHT_LOSS and HEAVY_LOSS, probe upwards below
+static const double DECREASE_FACTOR = 0.7;
+static const double JITTER_RISE = 1.5; // jitter this many times its smoothed value means a queue builds up
+static const double JITTER_DECREASE_FACTOR = 0.85;
+static const double INCREASE_STEP = 0.05; // of the maximum bitrate, per clean report
+static const double TIER_DOWN_RATIO = 0.4;
+static const double TIER_UP_RATIO = 0.7;
+static const long STALE_MILLIS = 10000; // receivers that stopped reporting this long ago no longer count
+static const long HOLD_MILLIS = 1000; // minimum time between two changes
+
+static long elapsedMillis(const struct timeval &from, const struct timeval &to) {
+    return (to.tv_sec - from.tv_sec) * 1000L + (to.tv_usec - from.tv_usec) / 1000L;
+}
+
+ExchangerRateController::ExchangerRateController(int minBitrateKbps, int maxBitrateKbps, int startBitrateKbps)
+        : minBitrateKbps(minBitrateKbps), maxBitrateKbps(maxBitrateKbps), lastChange(),
+          bitrateKbps(std::max(minBitrateKbps, std::min(startBitrateKbps, maxBitrateKbps))), resolutionTier(0),
+          packedTarget(0) {
+    publish(bitrateKbps, resolutionTier);
+}
+
+void ExchangerRateController::onReceiverReport(const void *receiver, double lossFraction,
+                                               double jitterMillis, double roundTripMillis) {
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    auto found = receivers.find(receiver);
+    if (found == receivers.end()) {
+        ReceiverState state = ReceiverState();
+        state.smoothedJitterMillis = jitterMillis;
+        found = receivers.insert(std::make_pair(receiver, state)).first;
+    }
+    ReceiverState &state = found->second;
+    state.lastReport = now;
+    state.lossFraction = lossFraction;
+    state.jitterMillis = jitterMillis;
+    state.roundTripMillis = roundTripMillis;
+    decide(now);
+    // smoothed after deciding, so a jump shows against the history
+    state.smoothedJitterMillis = state.smoothedJitterMillis * 0.875 + jitterMillis * 0.125;
+}
+
+void ExchangerRateController::removeReceiver(const void *receiver) {
+    receivers.erase(receiver);
+}
+
+ExchangerRateTarget ExchangerRateController::getTarget() const {
+    unsigned long long packed = packedTarget.load(std::memory_order_acquire);
+    ExchangerRateTarget target;
+    target.bitrateKbps = static_cast<int>(packed & 0xffffffffULL);
+    target.resolutionTier = static_cast<int>((packed >> 32) & 0xffULL);
+    target.generation = static_cast<unsigned>(packed >> 40);
+    return target;
+}
+
+void ExchangerRateController::decide(const struct timeval &now) {
+    if (elapsedMillis(lastChange, now) < HOLD_MILLIS) {
+        return;
+    }
+    double worstLoss = 0;
+    bool jitterRising = false;
+    for (auto it = receivers.begin(); it != receivers.end();) {
+        if (elapsedMillis(it->second.lastReport, now) > STALE_MILLIS) {
+            it = receivers.erase(it);
+            continue;
+        }
+        worstLoss = std::max(worstLoss, it->second.lossFraction);
+        // a couple of milliseconds of jitter is noise, not a queue
+        if (it->second.jitterMillis > it->second.smoothedJitterMillis * JITTER_RISE
+            && it->second.jitterMillis > 5) {
+            jitterRising = true;
+        }
+        ++it;
+    }
+
+    int next = bitrateKbps;
+    if (worstLoss > HEAVY_LOSS) {
+        next = static_cast<int>(bitrateKbps * DECREASE_FACTOR);
+    } else if (jitterRising) {
+        next = static_cast<int>(bitrateKbps * JITTER_DECREASE_FACTOR);
+    } else if (worstLoss < LIGHT_LOSS) {
+        next = bitrateKbps + std::max(1, static_cast<int>(maxBitrateKbps * INCREASE_STEP));
+    }
+    next = std::max(minBitrateKbps, std::min(next, maxBitrateKbps));
+
+    int tier = resolutionTier;
+    if (tier == 0 && next < maxBitrateKbps * TIER_DOWN_RATIO) {
+        tier = 1;
+    } else if (tier == 1 && next > maxBitrateKbps * TIER_UP_RATIO) {
+        tier = 0;
+    }
+
+    if (next != bitrateKbps || tier != resolutionTier) {
+        LOGW("rate control: loss %.3f%s, %d -> %d kbps, tier %d\n", worstLoss, jitterRising ? ", jitter rising" : "",
+             bitrateKbps, next, tier);
+        lastChange = now;
+        publish(next, tier);
+    }
+}
+
+void ExchangerRateController::publish(int bitrateKbps, int resolutionTier) {
+    this->bitrateKbps = bitrateKbps;
+    this->resolutionTier = resolutionTier;
+    unsigned long long generation = (packedTarget.load(std::memory_order_relaxed) >> 40) + 1;
+    packedTarget.store((generation << 40) | (static_cast<unsigned long long>(resolutionTier) << 32)
+                       | static_cast<unsigned>(bitrateKbps), std::memory_order_release);
+}
+
+ExchangerRTCPInstance *ExchangerRTCPInstance::createNew(UsageEnvironment &env, Groupsock *RTCPgs,
+                                                        unsigned totSessionBW, unsigned char const *cname,
+                                                        RTPSink *sink, ExchangerRateController *rateController) {
+    return new ExchangerRTCPInstance(env, RTCPgs, totSessionBW, cname, sink, rateController);
+}
+
+ExchangerRTCPInstance::ExchangerRTCPInstance(UsageEnvironment &env, Groupsock *RTCPgs, unsigned totSessionBW,
+                                             unsigned char const *cname, RTPSink *sink,
+                                             ExchangerRateController *rateController)
+        : RTCPInstance(env, RTCPgs, totSessionBW, cname, sink, nullptr /*we're a server*/, False),
+          sink(sink), rateController(rateController) {
+}
+
+ExchangerRTCPInstance::~ExchangerRTCPInstance() {
+    for (auto &receiver : receivers) {
+        rateController->removeReceiver(receiver.first);
+    }
+}
+
+void ExchangerRTCPInstance::noteArrivingRR(struct sockaddr_in const &fromAddressAndPort,
+                                           int tcpSocketNum, unsigned char tcpStreamChannelId) {
+    RTCPInstance::noteArrivingRR(fromAddressAndPort, tcpSocketNum, tcpStreamChannelId);
+    if (!sink) {
+        return;
+    }
+    // the report blocks have been noted in the transmission stats by now
+    double unitsPerMilli = sink->rtpTimestampFrequency() / 1000.0;
+    RTPTransmissionStatsDB::Iterator iterator(sink->transmissionStatsDB());
+    RTPTransmissionStats *stats;
+    while ((stats = iterator.next()) != nullptr) {
+        // a shared sink holds every client's stats, only pass on the ones this report refreshed
+        struct timeval &seen = receivers[stats];
+        if (seen.tv_sec == stats->lastTimeReceived().tv_sec && seen.tv_usec == stats->lastTimeReceived().tv_usec) {
+            continue;
+        }
+        seen = stats->lastTimeReceived();
+        rateController->onReceiverReport(stats, stats->packetLossRatio() / 256.0,
+                                         unitsPerMilli > 0 ? stats->jitter() / unitsPerMilli : 0,
+                                         stats->roundTripDelay() * 1000.0 / 65536.0);
+    }
+}
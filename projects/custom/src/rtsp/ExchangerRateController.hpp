@@ -0,0 +1,92 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Turns the RTCP receiver reports of every client of a live stream into one encoder target:
+ * the worst recent receiver decides. Heavy loss cuts the bitrate multiplicatively, rising jitter
+ * (a queue building up somewhere on the path) cuts it gently, clean reports raise it additively.
+ * Well below the maximum bitrate the encoder is asked to halve the resolution, well above to go back.
+ * Reports arrive on the event loop thread, the encoder thread polls getTarget().
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#ifndef EXCHANGER_RATE_CONTROLLER_H
+#define EXCHANGER_RATE_CONTROLLER_H
+
+#include <atomic>
+#include <map>
+#include <sys/time.h>
+#include "RTCP.hh"
+
+struct ExchangerRateTarget {
+    int bitrateKbps;
+    int resolutionTier; // 0: full size, 1: half width and height
+    unsigned generation; // changes whenever the target does
+};
+
+class ExchangerRateController {
+public:
+    ExchangerRateController(int minBitrateKbps, int maxBitrateKbps, int startBitrateKbps);
+
+    // lossFraction of the packets sent since the previous report, jitter and round trip in milliseconds
+    void onReceiverReport(const void *receiver, double lossFraction, double jitterMillis, double roundTripMillis);
+    void removeReceiver(const void *receiver);
+    // may be called from any thread
+    ExchangerRateTarget getTarget() const;
+
+private:
+    struct ReceiverState {
+        struct timeval lastReport;
+        double lossFraction;
+        double jitterMillis;
+        double smoothedJitterMillis;
+        double roundTripMillis;
+    };
+
+    void decide(const struct timeval &now);
+    void publish(int bitrateKbps, int resolutionTier);
+
+private:
+    const int minBitrateKbps;
+    const int maxBitrateKbps;
+    std::map<const void *, ReceiverState> receivers; // event loop thread only
+    struct timeval lastChange;
+    int bitrateKbps;
+    int resolutionTier;
+    std::atomic<unsigned long long> packedTarget; // generation << 40 | tier << 32 | bitrate
+};
+
+// reports every receiver report of its sink's clients to an ExchangerRateController
+class ExchangerRTCPInstance: public RTCPInstance {
+public:
+    static ExchangerRTCPInstance *createNew(UsageEnvironment &env, Groupsock *RTCPgs, unsigned totSessionBW,
+                                            unsigned char const *cname, RTPSink *sink,
+                                            ExchangerRateController *rateController);
+protected:
+    ExchangerRTCPInstance(UsageEnvironment &env, Groupsock *RTCPgs, unsigned totSessionBW,
+                          unsigned char const *cname, RTPSink *sink, ExchangerRateController *rateController);
+    ~ExchangerRTCPInstance() override;
+
+    void noteArrivingRR(struct sockaddr_in const &fromAddressAndPort,
+                        int tcpSocketNum, unsigned char tcpStreamChannelId) override;
+private:
+    RTPSink *sink;
+    ExchangerRateController *rateController;
+    // reported so far with the time of their last report, removed from rateController on destruction
+    std::map<const void *, struct timeval> receivers;
+};
+
+#endif // EXCHANGER_RATE_CONTROLLER_H
@@ -0,0 +1,215 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Every field of a stream is guarded by the scheduler mutex; it is held only to flip the busy flag
+ * and to update the counters, never while a stream encodes.
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#include "common.h"
+#include "encode_scheduler.h"
+#include "../john_collections/john_worker_pool.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <time.h>
+
+typedef struct EncodeStream {
+    EncodeScheduler *scheduler;
+    EncodeFrameFunc func;
+    void *stream_params;
+    bool busy;      /* an encode task is submitted or running */
+    bool removing;
+    uint64_t tick;  /* of the submitted encode */
+    EncodeStreamStats stats;
+} EncodeStream;
+
+struct EncodeScheduler {
+    JohnWorkerPool *worker_pool;
+    uint64_t interval_nanos;
+    uint64_t tick;
+    pthread_t clock_thread;
+    bool running;
+    pthread_mutex_t mutex;
+    pthread_cond_t encode_done;
+    EncodeStream *streams[ENCODE_SCHEDULER_MAX_STREAMS];
+};
+
+static inline uint64_t now_nanos() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+static void do_encode_task(void *params) {
+    EncodeStream *stream = (EncodeStream *) params;
+    EncodeScheduler *scheduler = stream->scheduler;
+    uint64_t start = now_nanos();
+    bool more = stream->func(stream->stream_params, stream->tick);
+    uint64_t nanos = now_nanos() - start;
+    pthread_mutex_lock(&scheduler->mutex);
+    ++stream->stats.encoded_frames;
+    stream->stats.total_encode_nanos += nanos;
+    if (nanos > stream->stats.max_encode_nanos) {
+        stream->stats.max_encode_nanos = nanos;
+    }
+    stream->stats.ended = !more;
+    stream->busy = false;
+    pthread_cond_broadcast(&scheduler->encode_done);
+    pthread_mutex_unlock(&scheduler->mutex);
+}
+
+static void *do_clock(void *params) {
+    EncodeScheduler *scheduler = (EncodeScheduler *) params;
+    uint64_t next_tick = now_nanos() + scheduler->interval_nanos;
+    pthread_mutex_lock(&scheduler->mutex);
+    while (scheduler->running) {
+        pthread_mutex_unlock(&scheduler->mutex);
+        struct timespec tick = { (time_t) (next_tick / 1000000000ULL), (long) (next_tick % 1000000000ULL) };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tick, NULL) != 0) {
+        }
+        next_tick += scheduler->interval_nanos;
+        uint64_t now = now_nanos();
+        if (next_tick < now) {
+            /* fell behind by more than a tick (suspended, or starved), restart the clock rather than bursting */
+            next_tick = now + scheduler->interval_nanos;
+        }
+        pthread_mutex_lock(&scheduler->mutex);
+        ++scheduler->tick;
+        for (int i = 0; i < ENCODE_SCHEDULER_MAX_STREAMS; ++i) {
+            EncodeStream *stream = scheduler->streams[i];
+            if (!stream || stream->removing || stream->stats.ended) {
+                continue;
+            }
+            if (stream->busy) {
+                ++stream->stats.late_frames;
+                continue;
+            }
+            stream->busy = true;
+            stream->tick = scheduler->tick;
+            if (!john_worker_pool_submit(scheduler->worker_pool, do_encode_task, stream)) {
+                /* the tick is lost like a late one; remove_encode_stream may be waiting for the flag */
+                LOGW("do_clock: john_worker_pool_submit failed!\n");
+                stream->busy = false;
+                ++stream->stats.late_frames;
+                pthread_cond_broadcast(&scheduler->encode_done);
+            }
+        }
+    }
+    pthread_mutex_unlock(&scheduler->mutex);
+    return NULL;
+}
+
+EncodeScheduler *create_encode_scheduler(uint32_t thread_count, int fps_num, int fps_den) {
+    if (fps_num <= 0 || fps_den <= 0) {
+        LOGW("create_encode_scheduler: bad frame rate %d/%d!\n", fps_num, fps_den);
+        return NULL;
+    }
+    EncodeScheduler *scheduler = (EncodeScheduler *) malloc(sizeof(EncodeScheduler));
+    if (!scheduler) {
+        return NULL;
+    }
+    memset(scheduler, 0, sizeof(EncodeScheduler));
+    scheduler->worker_pool = john_worker_pool_create(thread_count);
+    if (!scheduler->worker_pool) {
+        LOGW("john_worker_pool_create failed!\n");
+        free(scheduler);
+        return NULL;
+    }
+    scheduler->interval_nanos = 1000000000ULL * fps_den / fps_num;
+    scheduler->running = true;
+    pthread_mutex_init(&scheduler->mutex, NULL);
+    pthread_cond_init(&scheduler->encode_done, NULL);
+    pthread_create(&scheduler->clock_thread, NULL, do_clock, scheduler);
+    return scheduler;
+}
+
+int add_encode_stream(EncodeScheduler *scheduler, EncodeFrameFunc func, void *stream_params) {
+    EncodeStream *stream = (EncodeStream *) malloc(sizeof(EncodeStream));
+    if (!stream) {
+        return -1;
+    }
+    memset(stream, 0, sizeof(EncodeStream));
+    stream->scheduler = scheduler;
+    stream->func = func;
+    stream->stream_params = stream_params;
+    pthread_mutex_lock(&scheduler->mutex);
+    for (int i = 0; i < ENCODE_SCHEDULER_MAX_STREAMS; ++i) {
+        if (!scheduler->streams[i]) {
+            scheduler->streams[i] = stream;
+            pthread_mutex_unlock(&scheduler->mutex);
+            return i;
+        }
+    }
+    pthread_mutex_unlock(&scheduler->mutex);
+    free(stream);
+    LOGW("add_encode_stream: %d streams already scheduled!\n", ENCODE_SCHEDULER_MAX_STREAMS);
+    return -1;
+}
+
+void remove_encode_stream(EncodeScheduler *scheduler, int stream_id) {
+    if (stream_id < 0 || stream_id >= ENCODE_SCHEDULER_MAX_STREAMS) {
+        return;
+    }
+    pthread_mutex_lock(&scheduler->mutex);
+    EncodeStream *stream = scheduler->streams[stream_id];
+    if (!stream || stream->removing) {
+        pthread_mutex_unlock(&scheduler->mutex);
+        return;
+    }
+    stream->removing = true;
+    while (stream->busy) {
+        pthread_cond_wait(&scheduler->encode_done, &scheduler->mutex);
+    }
+    scheduler->streams[stream_id] = NULL;
+    pthread_mutex_unlock(&scheduler->mutex);
+    free(stream);
+}
+
+bool get_encode_stream_stats(EncodeScheduler *scheduler, int stream_id, EncodeStreamStats *stats) {
+    if (stream_id < 0 || stream_id >= ENCODE_SCHEDULER_MAX_STREAMS) {
+        return false;
+    }
+    pthread_mutex_lock(&scheduler->mutex);
+    EncodeStream *stream = scheduler->streams[stream_id];
+    if (stream) {
+        *stats = stream->stats;
+    }
+    pthread_mutex_unlock(&scheduler->mutex);
+    return stream != NULL;
+}
+
+uint32_t get_encode_scheduler_thread_count(EncodeScheduler *scheduler) {
+    return john_worker_pool_thread_count(scheduler->worker_pool);
+}
+
+void destroy_encode_scheduler(EncodeScheduler *scheduler) {
+    if (!scheduler) {
+        return;
+    }
+    pthread_mutex_lock(&scheduler->mutex);
+    scheduler->running = false;
+    pthread_mutex_unlock(&scheduler->mutex);
+    pthread_join(scheduler->clock_thread, NULL);
+    for (int i = 0; i < ENCODE_SCHEDULER_MAX_STREAMS; ++i) {
+        remove_encode_stream(scheduler, i);
+    }
+    john_worker_pool_destroy(scheduler->worker_pool);
+    pthread_cond_destroy(&scheduler->encode_done);
+    pthread_mutex_destroy(&scheduler->mutex);
+    free(scheduler);
+}
@@ -0,0 +1,69 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Paces the encoders of many live streams on one bounded JohnWorkerPool instead of one thread per stream.
+ * A clock thread ticks at the stream frame rate and hands every stream one encode task per tick; a stream
+ * whose previous encode is still running when its tick comes skips that tick, so an overloaded host drops
+ * frames instead of queueing them up, and the skipped ticks are reported as late frames.
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#ifndef ENCODE_SCHEDULER_H
+#define ENCODE_SCHEDULER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ENCODE_SCHEDULER_MAX_STREAMS 256
+
+/** encodes the next frame of a stream on a pool worker, never concurrently for the same stream;
+ *  tick numbers the clock ticks of the scheduler (the capture time in frames, a skipped tick leaves a gap),
+ *  so it makes a pts; returns false once the stream has no more frames, it is not called again then **/
+typedef bool (*EncodeFrameFunc)(void *stream_params, uint64_t tick);
+
+typedef struct EncodeStreamStats {
+    uint64_t encoded_frames;
+    uint64_t late_frames;        /* ticks skipped because the previous encode of the stream was still running,
+                                  * or because it could not be submitted */
+    uint64_t total_encode_nanos;
+    uint64_t max_encode_nanos;
+    bool ended;                  /* func returned false */
+} EncodeStreamStats;
+
+typedef struct EncodeScheduler EncodeScheduler;
+
+/** thread_count 0 means one worker per online cpu **/
+EncodeScheduler *create_encode_scheduler(uint32_t thread_count, int fps_num, int fps_den);
+/** returns the stream id, or -1 if ENCODE_SCHEDULER_MAX_STREAMS are already scheduled;
+ *  the first encode runs on the next tick **/
+int add_encode_stream(EncodeScheduler *scheduler, EncodeFrameFunc func, void *stream_params);
+/** no encode of the stream is running any more when it returns, stream_params may be freed then **/
+void remove_encode_stream(EncodeScheduler *scheduler, int stream_id);
+bool get_encode_stream_stats(EncodeScheduler *scheduler, int stream_id, EncodeStreamStats *stats);
+uint32_t get_encode_scheduler_thread_count(EncodeScheduler *scheduler);
+/** removes the streams still scheduled **/
+void destroy_encode_scheduler(EncodeScheduler *scheduler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ENCODE_SCHEDULER_H */
@@ -0,0 +1,309 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#include "common.h"
+#include "frame_converter.h"
+#include "../john_collections/john_worker_pool.h"
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <unistd.h>
+
+#define FRAME_CONVERTER_MAX_SLICES 64
+/* even, so every chunk starts on a chroma sample; the planar chunks stay in L1 */
+#define YUV_CHUNK_PIXELS 512
+
+/* fixed point, 8 fractional bits: r = (y' + r_v * v'), g = (y' + g_u * u' + g_v * v'), b = (y' + b_u * u'),
+ * with y' = (y - y_offset) * y_scale and u', v' centred on 128 */
+typedef struct YuvToRgb {
+    int32_t y_offset;
+    int32_t y_scale;
+    int32_t r_v;
+    int32_t g_u;
+    int32_t g_v;
+    int32_t b_u;
+} YuvToRgb;
+
+static const YuvToRgb BT601_LIMITED_RANGE = { 16, 298, 409, -100, -208, 516 };
+static const YuvToRgb BT601_FULL_RANGE = { 0, 256, 359, -88, -183, 454 };
+
+typedef void (*YuvRowFunc)(const uint8_t *y_row, const uint8_t *u_row, const uint8_t *v_row,
+                           uint8_t *out, int width, const YuvToRgb *k);
+
+typedef struct ConvertSlice {
+    FrameConverter *converter;
+    struct SwsContext *sws_context; /* of this slice only */
+    int y;
+    int height;
+} ConvertSlice;
+
+struct FrameConverter {
+    JohnWorkerPool *worker_pool; /* NULL when the calling thread converts alone */
+    uint32_t thread_count;
+    int sws_flags;
+    bool fast_path;
+    struct SwsContext *scale_context; /* for conversions that scale, see frame_converter.h */
+    /* the conversion running */
+    const AVFrame *src;
+    AVFrame *dst;
+    YuvRowFunc yuv_row;
+    const YuvToRgb *yuv_to_rgb;
+    atomic_bool failed;
+    ConvertSlice slices[FRAME_CONVERTER_MAX_SLICES];
+};
+
+static inline uint8_t clamp_u8(int32_t value) {
+    return (uint8_t) (value < 0 ? 0 : value > 255 ? 255 : value);
+}
+
+/* a chunk of one luma row, with the chroma row it shares with its neighbour, to planar r, g and b */
+static void convert_yuv420p_chunk(const uint8_t *restrict y_row, const uint8_t *restrict u_row,
+                                  const uint8_t *restrict v_row, uint8_t *restrict r, uint8_t *restrict g,
+                                  uint8_t *restrict b, int width, const YuvToRgb *k) {
+    const int32_t y_offset = k->y_offset, y_scale = k->y_scale;
+    const int32_t r_v = k->r_v, g_u = k->g_u, g_v = k->g_v, b_u = k->b_u;
+    for (int i = 0; i < width / 2; ++i) {
+        int32_t u = u_row[i] - 128, v = v_row[i] - 128;
+        int32_t r_chroma = r_v * v + 128, g_chroma = g_u * u + g_v * v + 128, b_chroma = b_u * u + 128;
+        int32_t y0 = (y_row[2 * i] - y_offset) * y_scale, y1 = (y_row[2 * i + 1] - y_offset) * y_scale;
+        r[2 * i] = clamp_u8((y0 + r_chroma) >> 8);
+        r[2 * i + 1] = clamp_u8((y1 + r_chroma) >> 8);
+        g[2 * i] = clamp_u8((y0 + g_chroma) >> 8);
+        g[2 * i + 1] = clamp_u8((y1 + g_chroma) >> 8);
+        b[2 * i] = clamp_u8((y0 + b_chroma) >> 8);
+        b[2 * i + 1] = clamp_u8((y1 + b_chroma) >> 8);
+    }
+    if (width & 1) {
+        int32_t u = u_row[width / 2] - 128, v = v_row[width / 2] - 128;
+        int32_t y0 = (y_row[width - 1] - y_offset) * y_scale;
+        r[width - 1] = clamp_u8((y0 + r_v * v + 128) >> 8);
+        g[width - 1] = clamp_u8((y0 + g_u * u + g_v * v + 128) >> 8);
+        b[width - 1] = clamp_u8((y0 + b_u * u + 128) >> 8);
+    }
+}
+
+/* the arithmetic and the interleaving vectorize well apart, not fused into one loop with strided stores;
+ * the constant channel offsets of the wrappers below give every output layout its own interleaving loop */
+static inline void convert_yuv420p_row(const uint8_t *y_row, const uint8_t *u_row, const uint8_t *v_row,
+                                       uint8_t *restrict out, int width, const YuvToRgb *k,
+                                       int pixel_size, int r, int g, int b, int a) {
+    uint8_t r_chunk[YUV_CHUNK_PIXELS], g_chunk[YUV_CHUNK_PIXELS], b_chunk[YUV_CHUNK_PIXELS];
+    for (int x = 0; x < width; x += YUV_CHUNK_PIXELS) {
+        int count = FFMIN(YUV_CHUNK_PIXELS, width - x);
+        convert_yuv420p_chunk(y_row + x, u_row + x / 2, v_row + x / 2, r_chunk, g_chunk, b_chunk, count, k);
+        uint8_t *pixels = out + x * pixel_size;
+        for (int i = 0; i < count; ++i) {
+            pixels[i * pixel_size + r] = r_chunk[i];
+            pixels[i * pixel_size + g] = g_chunk[i];
+            pixels[i * pixel_size + b] = b_chunk[i];
+            if (a >= 0) {
+                pixels[i * pixel_size + a] = 255;
+            }
+        }
+    }
+}
+
+static void convert_yuv420p_row_bgr24(const uint8_t *y_row, const uint8_t *u_row, const uint8_t *v_row,
+                                      uint8_t *out, int width, const YuvToRgb *k) {
+    convert_yuv420p_row(y_row, u_row, v_row, out, width, k, 3, 2, 1, 0, -1);
+}
+
+static void convert_yuv420p_row_rgb24(const uint8_t *y_row, const uint8_t *u_row, const uint8_t *v_row,
+                                      uint8_t *out, int width, const YuvToRgb *k) {
+    convert_yuv420p_row(y_row, u_row, v_row, out, width, k, 3, 0, 1, 2, -1);
+}
+
+static void convert_yuv420p_row_bgra(const uint8_t *y_row, const uint8_t *u_row, const uint8_t *v_row,
+                                     uint8_t *out, int width, const YuvToRgb *k) {
+    convert_yuv420p_row(y_row, u_row, v_row, out, width, k, 4, 2, 1, 0, 3);
+}
+
+static void convert_yuv420p_row_rgba(const uint8_t *y_row, const uint8_t *u_row, const uint8_t *v_row,
+                                     uint8_t *out, int width, const YuvToRgb *k) {
+    convert_yuv420p_row(y_row, u_row, v_row, out, width, k, 4, 0, 1, 2, 3);
+}
+
+static YuvRowFunc find_yuv_row_func(enum AVPixelFormat src_format, enum AVPixelFormat dst_format) {
+    if (src_format != AV_PIX_FMT_YUV420P && src_format != AV_PIX_FMT_YUVJ420P) {
+        return NULL;
+    }
+    switch (dst_format) {
+        case AV_PIX_FMT_BGR24:
+            return convert_yuv420p_row_bgr24;
+        case AV_PIX_FMT_RGB24:
+            return convert_yuv420p_row_rgb24;
+        case AV_PIX_FMT_BGRA:
+            return convert_yuv420p_row_bgra;
+        case AV_PIX_FMT_RGBA:
+            return convert_yuv420p_row_rgba;
+        default:
+            return NULL;
+    }
+}
+
+bool has_fast_frame_conversion(enum AVPixelFormat src_format, enum AVPixelFormat dst_format) {
+    return find_yuv_row_func(src_format, dst_format) != NULL;
+}
+
+/* the planes of frame from row y on; only the chroma planes are subsampled vertically */
+static void offset_planes(const AVFrame *frame, int y, uint8_t *planes[AV_NUM_DATA_POINTERS]) {
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get((enum AVPixelFormat) frame->format);
+    for (int i = 0; i < AV_NUM_DATA_POINTERS; ++i) {
+        int shift = (i == 1 || i == 2) ? desc->log2_chroma_h : 0;
+        planes[i] = frame->data[i] ? frame->data[i] + (y >> shift) * frame->linesize[i] : NULL;
+    }
+}
+
+static void convert_slice(void *params) {
+    ConvertSlice *slice = (ConvertSlice *) params;
+    FrameConverter *converter = slice->converter;
+    const AVFrame *src = converter->src;
+    AVFrame *dst = converter->dst;
+    if (converter->yuv_row) {
+        for (int y = slice->y; y < slice->y + slice->height; ++y) {
+            converter->yuv_row(src->data[0] + y * src->linesize[0], src->data[1] + (y >> 1) * src->linesize[1],
+                               src->data[2] + (y >> 1) * src->linesize[2], dst->data[0] + y * dst->linesize[0],
+                               src->width, converter->yuv_to_rgb);
+        }
+        return;
+    }
+    slice->sws_context = sws_getCachedContext(slice->sws_context, src->width, slice->height,
+                                              (enum AVPixelFormat) src->format, dst->width, slice->height,
+                                              (enum AVPixelFormat) dst->format, converter->sws_flags,
+                                              NULL, NULL, NULL);
+    uint8_t *src_planes[AV_NUM_DATA_POINTERS], *dst_planes[AV_NUM_DATA_POINTERS];
+    offset_planes(src, slice->y, src_planes);
+    offset_planes(dst, slice->y, dst_planes);
+    if (!slice->sws_context || sws_scale(slice->sws_context, (const uint8_t *const *) src_planes, src->linesize,
+                                         0, slice->height, dst_planes, dst->linesize) < 0) {
+        atomic_store(&converter->failed, true);
+    }
+}
+
+FrameConverter *create_frame_converter(uint32_t thread_count, int sws_flags) {
+    if (thread_count == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cpus > 0 ? (uint32_t) cpus : 1;
+    }
+    if (thread_count > FRAME_CONVERTER_MAX_SLICES) {
+        thread_count = FRAME_CONVERTER_MAX_SLICES;
+    }
+    FrameConverter *converter = (FrameConverter *) malloc(sizeof(FrameConverter));
+    if (!converter) {
+        return NULL;
+    }
+    memset(converter, 0, sizeof(FrameConverter));
+    /* the calling thread converts a slice itself while it waits for the others */
+    if (thread_count > 1 && !(converter->worker_pool = john_worker_pool_create(thread_count - 1))) {
+        LOGW("john_worker_pool_create failed!\n");
+        free(converter);
+        return NULL;
+    }
+    converter->thread_count = thread_count;
+    converter->sws_flags = sws_flags;
+    converter->fast_path = true;
+    for (uint32_t i = 0; i < thread_count; ++i) {
+        converter->slices[i].converter = converter;
+    }
+    return converter;
+}
+
+int convert_frame(FrameConverter *converter, const AVFrame *src, AVFrame *dst) {
+    if (!converter || !src || !dst) {
+        return -1;
+    }
+    if (src->width != dst->width || src->height != dst->height) {
+        converter->scale_context = sws_getCachedContext(converter->scale_context, src->width, src->height,
+                                                        (enum AVPixelFormat) src->format, dst->width, dst->height,
+                                                        (enum AVPixelFormat) dst->format, converter->sws_flags,
+                                                        NULL, NULL, NULL);
+        if (!converter->scale_context || sws_scale(converter->scale_context, (const uint8_t *const *) src->data,
+                                                   src->linesize, 0, src->height, dst->data, dst->linesize) < 0) {
+            LOGW("sws_scale failed!\n");
+            return -1;
+        }
+        return 0;
+    }
+
+    const AVPixFmtDescriptor *src_desc = av_pix_fmt_desc_get((enum AVPixelFormat) src->format);
+    const AVPixFmtDescriptor *dst_desc = av_pix_fmt_desc_get((enum AVPixelFormat) dst->format);
+    if (!src_desc || !dst_desc) {
+        return -1;
+    }
+    converter->src = src;
+    converter->dst = dst;
+    converter->yuv_row = converter->fast_path
+                         ? find_yuv_row_func((enum AVPixelFormat) src->format, (enum AVPixelFormat) dst->format)
+                         : NULL;
+    converter->yuv_to_rgb = src->format == AV_PIX_FMT_YUVJ420P || src->color_range == AVCOL_RANGE_JPEG
+                            ? &BT601_FULL_RANGE : &BT601_LIMITED_RANGE;
+    atomic_store(&converter->failed, false);
+
+    /* slices start on a chroma row; a palette is not a plane that can be sliced */
+    uint32_t slice_count = converter->thread_count;
+    if ((src_desc->flags | dst_desc->flags) & AV_PIX_FMT_FLAG_PAL) {
+        slice_count = 1;
+    }
+    int align = 1 << FFMAX(src_desc->log2_chroma_h, dst_desc->log2_chroma_h);
+    int rows = (src->height + (int) slice_count - 1) / (int) slice_count;
+    rows = (rows + align - 1) / align * align;
+    uint32_t used = 0;
+    for (int y = 0; y < src->height; y += rows) {
+        ConvertSlice *slice = &converter->slices[used++];
+        slice->y = y;
+        slice->height = FFMIN(rows, src->height - y);
+    }
+    for (uint32_t i = 1; i < used; ++i) {
+        if (!john_worker_pool_submit(converter->worker_pool, convert_slice, &converter->slices[i])) {
+            /* every slice has its own context, so the calling thread can take this one over */
+            convert_slice(&converter->slices[i]);
+        }
+    }
+    convert_slice(&converter->slices[0]);
+    if (used > 1) {
+        john_worker_pool_wait_idle(converter->worker_pool);
+    }
+    if (atomic_load(&converter->failed)) {
+        LOGW("sws_scale failed!\n");
+        return -1;
+    }
+    return 0;
+}
+
+void set_frame_converter_fast_path(FrameConverter *converter, bool enabled) {
+    converter->fast_path = enabled;
+}
+
+uint32_t get_frame_converter_thread_count(FrameConverter *converter) {
+    return converter->thread_count;
+}
+
+void destroy_frame_converter(FrameConverter *converter) {
+    if (converter) {
+        john_worker_pool_destroy(converter->worker_pool);
+        for (uint32_t i = 0; i < converter->thread_count; ++i) {
+            sws_freeContext(converter->slices[i].sws_context);
+        }
+        sws_freeContext(converter->scale_context);
+        free(converter);
+    }
+}
@@ -0,0 +1,57 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Converts decoded pictures to the output pixel format in horizontal slices, spread over a worker pool of its own.
+ * YUV420P/YUVJ420P to BGR24, RGB24, BGRA or RGBA at the same size takes a fixed point BT.601 fast path, written
+ * as plain loops for the compiler's vectorizer (no intrinsics, so the ARM builds get it too). Other same size
+ * conversions run sws_scale with one SwsContext per slice, since a context is not thread safe; a conversion that
+ * also scales needs the whole source picture, so it runs on the calling thread with a single context.
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#ifndef FRAME_CONVERTER_H
+#define FRAME_CONVERTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+
+typedef struct FrameConverter FrameConverter;
+
+/** thread_count 0 means one worker per online cpu, 1 converts on the calling thread only;
+ *  sws_flags (e.g. SWS_BICUBIC) are used wherever sws_scale runs **/
+FrameConverter *create_frame_converter(uint32_t thread_count, int sws_flags);
+/** dst has its format, size and planes set already; returns 0, or -1 if the conversion failed.
+ *  One conversion at a time per converter. **/
+int convert_frame(FrameConverter *converter, const AVFrame *src, AVFrame *dst);
+/** whether convert_frame() takes the fast path for these formats at the same size **/
+bool has_fast_frame_conversion(enum AVPixelFormat src_format, enum AVPixelFormat dst_format);
+/** on by default; off runs sws_scale for every conversion, e.g. to compare the two **/
+void set_frame_converter_fast_path(FrameConverter *converter, bool enabled);
+uint32_t get_frame_converter_thread_count(FrameConverter *converter);
+void destroy_frame_converter(FrameConverter *converter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAME_CONVERTER_H */
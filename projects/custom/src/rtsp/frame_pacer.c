@@ -0,0 +1,100 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#include "common.h"
+#include "frame_pacer.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <time.h>
+
+struct FramePacer {
+    uint64_t interval_nanos;
+    uint64_t max_late_nanos;
+    bool anchored;
+    int64_t anchor_pts;
+    uint64_t anchor_monotonic_nanos;
+    uint64_t anchor_wall_micros;
+    uint64_t reanchors;
+};
+
+static inline uint64_t now_nanos() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+static void anchor_frame_pacer(FramePacer *pacer, int64_t pts) {
+    struct timeval wall;
+    gettimeofday(&wall, NULL);
+    pacer->anchor_pts = pts;
+    pacer->anchor_monotonic_nanos = now_nanos();
+    pacer->anchor_wall_micros = (uint64_t) wall.tv_sec * 1000000ULL + (uint64_t) wall.tv_usec;
+    pacer->anchored = true;
+}
+
+FramePacer *create_frame_pacer(int fps_num, int fps_den, uint32_t max_late_frames) {
+    if (fps_num <= 0 || fps_den <= 0) {
+        LOGW("create_frame_pacer: bad frame rate %d/%d!\n", fps_num, fps_den);
+        return NULL;
+    }
+    FramePacer *pacer = (FramePacer *) malloc(sizeof(FramePacer));
+    if (!pacer) {
+        return NULL;
+    }
+    memset(pacer, 0, sizeof(FramePacer));
+    pacer->interval_nanos = 1000000000ULL * fps_den / fps_num;
+    pacer->max_late_nanos = pacer->interval_nanos * max_late_frames;
+    return pacer;
+}
+
+void pace_frame(FramePacer *pacer, int64_t pts, PacedFrame *paced) {
+    if (!pacer->anchored || pts < pacer->anchor_pts) {
+        anchor_frame_pacer(pacer, pts);
+    }
+    uint64_t offset_nanos = (uint64_t) (pts - pacer->anchor_pts) * pacer->interval_nanos;
+    if (now_nanos() > pacer->anchor_monotonic_nanos + offset_nanos + pacer->max_late_nanos) {
+        anchor_frame_pacer(pacer, pts);
+        offset_nanos = 0;
+        ++pacer->reanchors;
+    }
+    uint64_t wall_micros = pacer->anchor_wall_micros + offset_nanos / 1000;
+    paced->presentation_time.tv_sec = (time_t) (wall_micros / 1000000ULL);
+    paced->presentation_time.tv_usec = (suseconds_t) (wall_micros % 1000000ULL);
+    paced->release_nanos = pacer->anchor_monotonic_nanos + offset_nanos;
+    paced->duration_micros = (uint32_t) (pacer->interval_nanos / 1000);
+}
+
+void reset_frame_pacer(FramePacer *pacer) {
+    pacer->anchored = false;
+}
+
+uint64_t get_frame_pacer_reanchors(FramePacer *pacer) {
+    return pacer->reanchors;
+}
+
+void destroy_frame_pacer(FramePacer *pacer) {
+    free(pacer);
+}
+
+int64_t get_release_delay_micros(uint64_t release_nanos) {
+    uint64_t now = now_nanos();
+    return release_nanos > now ? (int64_t) ((release_nanos - now) / 1000) : 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Maps the capture pts of a live stream to wall-clock presentation times and monotonic release times.
+ * The mapping is anchored once, at the first frame, so the timing the player sees follows the capture clock
+ * and not the jitter of the encoder, the queue or the event loop. A frame is released no earlier than its
+ * slot; a frame that comes out more than max_late_frames slots late (e.g. the encoder stalled) re-anchors
+ * the mapping instead of having every following frame go out late in a burst.
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <sys/time.h>
+
+typedef struct PacedFrame {
+    struct timeval presentation_time; /* wall clock, as live555 wants it */
+    uint64_t release_nanos;           /* CLOCK_MONOTONIC, see get_release_delay_micros */
+    uint32_t duration_micros;
+} PacedFrame;
+
+typedef struct FramePacer FramePacer;
+
+FramePacer *create_frame_pacer(int fps_num, int fps_den, uint32_t max_late_frames);
+/** pts is in frames, e.g. the capture tick; call it for increasing pts from one thread at a time **/
+void pace_frame(FramePacer *pacer, int64_t pts, PacedFrame *paced);
+/** the next frame anchors the mapping again, e.g. after the encoder restarted **/
+void reset_frame_pacer(FramePacer *pacer);
+/** how often a late frame re-anchored the mapping **/
+uint64_t get_frame_pacer_reanchors(FramePacer *pacer);
+void destroy_frame_pacer(FramePacer *pacer);
+/** microseconds until release_nanos, 0 if it has passed **/
+int64_t get_release_delay_micros(uint64_t release_nanos);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAME_PACER_H */
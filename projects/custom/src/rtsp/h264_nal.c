@@ -0,0 +1,72 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#include <stddef.h>
+#include "h264_nal.h"
+
+/* returns the first byte after a 00 00 01 start code, or end */
+static const uint8_t *h264_skip_start_code(const uint8_t *p, const uint8_t *end) {
+    while (end - p >= 3) {
+        if (p[2] > 1) {
+            p += 3;
+        } else if (p[2] == 1 && p[1] == 0 && p[0] == 0) {
+            return p + 3;
+        } else {
+            ++p;
+        }
+    }
+    return end;
+}
+
+const uint8_t *h264_next_nal(const uint8_t **cursor, const uint8_t *end, uint32_t *nal_size) {
+    const uint8_t *nal = h264_skip_start_code(*cursor, end);
+    if (nal >= end) {
+        *cursor = end;
+        return NULL;
+    }
+    const uint8_t *next = h264_skip_start_code(nal, end);
+    const uint8_t *nal_end = next == end ? end : next - 3;
+    /* the zero of a four byte start code and trailing_zero_8bits belong to no NAL unit */
+    while (nal_end > nal && nal_end[-1] == 0) {
+        --nal_end;
+    }
+    *cursor = next == end ? end : next - 3;
+    *nal_size = (uint32_t) (nal_end - nal);
+    return nal;
+}
+
+int h264_frame_priority(const uint8_t *data, uint32_t size) {
+    const uint8_t *cursor = data, *end = data + size, *nal;
+    uint32_t nal_size;
+    int priority = 0;
+    while ((nal = h264_next_nal(&cursor, end, &nal_size))) {
+        if (nal_size == 0) {
+            continue;
+        }
+        int type = H264_NAL_TYPE(nal);
+        if (type == H264_NAL_IDR) {
+            return 2;
+        }
+        if (type == H264_NAL_SLICE && H264_NAL_REF_IDC(nal) != 0) {
+            priority = 1;
+        }
+    }
+    return priority;
+}
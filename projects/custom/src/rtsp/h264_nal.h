@@ -0,0 +1,60 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Helpers for walking H.264 Annex-B byte streams as produced by x264.
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#ifndef H264_NAL_H
+#define H264_NAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define H264_NAL_SLICE 1
+#define H264_NAL_IDR 5
+#define H264_NAL_SEI 6
+#define H264_NAL_SPS 7
+#define H264_NAL_PPS 8
+#define H264_NAL_AUD 9
+
+#define H264_NAL_TYPE(nal) ((nal)[0] & 0x1f)
+#define H264_NAL_REF_IDC(nal) (((nal)[0] >> 5) & 0x03)
+
+/* NAL units may also be laid out the AVC sample way: each one prefixed by its 4 byte big-endian size */
+#define H264_NAL_LENGTH_SIZE 4
+#define H264_NAL_READ_LENGTH(p) (((uint32_t) (p)[0] << 24) | ((uint32_t) (p)[1] << 16) \
+                                 | ((uint32_t) (p)[2] << 8) | (uint32_t) (p)[3])
+#define H264_NAL_WRITE_LENGTH(p, length) do { (p)[0] = (uint8_t) ((length) >> 24); \
+                                              (p)[1] = (uint8_t) ((length) >> 16); \
+                                              (p)[2] = (uint8_t) ((length) >> 8); \
+                                              (p)[3] = (uint8_t) (length); } while (0)
+
+/** returns the next NAL unit at or after *cursor with its start code stripped, and moves *cursor past it;
+ *  returns NULL when no NAL unit is left **/
+const uint8_t *h264_next_nal(const uint8_t **cursor, const uint8_t *end, uint32_t *nal_size);
+/** 2 if the picture contains an IDR slice, 1 if it is referenced, 0 otherwise (same values as JohnFramePriority) **/
+int h264_frame_priority(const uint8_t *data, uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H264_NAL_H */
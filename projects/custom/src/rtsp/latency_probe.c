@@ -0,0 +1,188 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * The stamps go big-endian after the uuid; emulation prevention bytes are added and removed here,
+ * so a stamp may contain any byte pattern.
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#include "common.h"
+#include "h264_nal.h"
+#include "latency_probe.h"
+#include <stdlib.h>
+#include <memory.h>
+#include <sys/time.h>
+
+#define LATENCY_SEI_PAYLOAD_TYPE 5 /* user_data_unregistered */
+#define LATENCY_SEI_PAYLOAD_SIZE (16 + 3 * 8)
+#define LATENCY_BUCKET_MICROS 50
+#define LATENCY_BUCKET_COUNT 20000 /* one second, the last bucket takes everything above */
+#define LATENCY_LOG2_BUCKET_COUNT 12 /* < 0.25 ms, < 0.5 ms, ... < 256 ms, >= 256 ms */
+
+static const uint8_t latency_sei_uuid[16] = {
+    0x6a, 0x6f, 0x68, 0x6e, 0x2d, 0x6c, 0x61, 0x74, 0x65, 0x6e, 0x63, 0x79, 0x2d, 0x76, 0x30, 0x31
+};
+
+static const char *latency_stage_names[LATENCY_STAGE_COUNT] = {
+    "encode", "queue", "transport", "decode", "convert", "total"
+};
+
+typedef struct LatencyStageHistogram {
+    uint64_t count;
+    int64_t max_micros;
+    uint32_t buckets[LATENCY_BUCKET_COUNT];
+} LatencyStageHistogram;
+
+struct LatencyHistogram {
+    LatencyStageHistogram stages[LATENCY_STAGE_COUNT];
+};
+
+int64_t get_latency_clock_micros() {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (int64_t) now.tv_sec * 1000000 + now.tv_usec;
+}
+
+uint32_t write_latency_sei(const LatencyStamps *stamps, uint8_t nal[LATENCY_SEI_MAX_SIZE]) {
+    uint8_t rbsp[2 + LATENCY_SEI_PAYLOAD_SIZE + 1];
+    uint32_t rbsp_size = 0;
+    rbsp[rbsp_size++] = LATENCY_SEI_PAYLOAD_TYPE;
+    rbsp[rbsp_size++] = LATENCY_SEI_PAYLOAD_SIZE;
+    memcpy(rbsp + rbsp_size, latency_sei_uuid, sizeof(latency_sei_uuid));
+    rbsp_size += sizeof(latency_sei_uuid);
+    const int64_t values[3] = { stamps->captured_micros, stamps->encoded_micros, stamps->released_micros };
+    for (int i = 0; i < 3; ++i) {
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            rbsp[rbsp_size++] = (uint8_t) ((uint64_t) values[i] >> shift);
+        }
+    }
+    rbsp[rbsp_size++] = 0x80; /* rbsp_trailing_bits */
+
+    uint32_t size = 0, zeros = 0;
+    nal[size++] = H264_NAL_SEI;
+    for (uint32_t i = 0; i < rbsp_size; ++i) {
+        if (zeros >= 2 && rbsp[i] <= 3) {
+            nal[size++] = 3; /* emulation_prevention_three_byte */
+            zeros = 0;
+        }
+        nal[size++] = rbsp[i];
+        zeros = rbsp[i] ? 0 : zeros + 1;
+    }
+    return size;
+}
+
+bool read_latency_sei(const uint8_t *nal, uint32_t nal_size, LatencyStamps *stamps) {
+    if (nal_size < 2 || H264_NAL_TYPE(nal) != H264_NAL_SEI || nal_size > LATENCY_SEI_MAX_SIZE) {
+        return false;
+    }
+    uint8_t rbsp[LATENCY_SEI_MAX_SIZE];
+    uint32_t rbsp_size = 0, zeros = 0;
+    for (uint32_t i = 1; i < nal_size; ++i) {
+        if (zeros >= 2 && nal[i] == 3) {
+            zeros = 0;
+            continue;
+        }
+        rbsp[rbsp_size++] = nal[i];
+        zeros = nal[i] ? 0 : zeros + 1;
+    }
+    if (rbsp_size < 2 + LATENCY_SEI_PAYLOAD_SIZE || rbsp[0] != LATENCY_SEI_PAYLOAD_TYPE
+        || rbsp[1] != LATENCY_SEI_PAYLOAD_SIZE || memcmp(rbsp + 2, latency_sei_uuid, sizeof(latency_sei_uuid))) {
+        return false;
+    }
+    const uint8_t *p = rbsp + 2 + sizeof(latency_sei_uuid);
+    int64_t values[3];
+    for (int i = 0; i < 3; ++i) {
+        uint64_t value = 0;
+        for (int j = 0; j < 8; ++j) {
+            value = (value << 8) | *p++;
+        }
+        values[i] = (int64_t) value;
+    }
+    stamps->captured_micros = values[0];
+    stamps->encoded_micros = values[1];
+    stamps->released_micros = values[2];
+    return true;
+}
+
+LatencyHistogram *create_latency_histogram() {
+    LatencyHistogram *histogram = (LatencyHistogram *) calloc(1, sizeof(LatencyHistogram));
+    if (!histogram) {
+        LOGW("calloc LatencyHistogram failed!\n");
+    }
+    return histogram;
+}
+
+void record_latency(LatencyHistogram *histogram, LatencyStage stage, int64_t micros) {
+    LatencyStageHistogram *stage_histogram = &histogram->stages[stage];
+    if (micros < 0) {
+        /* the stamps of two threads a few microseconds apart */
+        micros = 0;
+    }
+    int64_t bucket = micros / LATENCY_BUCKET_MICROS;
+    ++stage_histogram->buckets[bucket < LATENCY_BUCKET_COUNT ? bucket : LATENCY_BUCKET_COUNT - 1];
+    ++stage_histogram->count;
+    if (micros > stage_histogram->max_micros) {
+        stage_histogram->max_micros = micros;
+    }
+}
+
+static double percentile_millis(const LatencyStageHistogram *stage_histogram, double quantile) {
+    uint64_t rank = (uint64_t) (quantile * (double) (stage_histogram->count - 1)), seen = 0;
+    for (uint32_t i = 0; i < LATENCY_BUCKET_COUNT; ++i) {
+        seen += stage_histogram->buckets[i];
+        if (seen > rank) {
+            /* the upper edge of the bucket, never above the worst one seen */
+            double millis = (double) ((i + 1) * LATENCY_BUCKET_MICROS) / 1000;
+            double max_millis = (double) stage_histogram->max_micros / 1000;
+            return millis < max_millis ? millis : max_millis;
+        }
+    }
+    return (double) stage_histogram->max_micros / 1000;
+}
+
+void print_latency_histogram(LatencyHistogram *histogram, FILE *out) {
+    fprintf(out, "%-10s %8s %9s %9s %9s %9s   %s\n", "stage", "frames", "p50(ms)", "p90(ms)", "p99(ms)",
+            "max(ms)", "frames per bucket: <0.25 <0.5 <1 <2 <4 <8 <16 <32 <64 <128 <256 >=256 ms");
+    for (int stage = 0; stage < LATENCY_STAGE_COUNT; ++stage) {
+        const LatencyStageHistogram *stage_histogram = &histogram->stages[stage];
+        if (stage_histogram->count == 0) {
+            fprintf(out, "%-10s %8d\n", latency_stage_names[stage], 0);
+            continue;
+        }
+        uint64_t log2_buckets[LATENCY_LOG2_BUCKET_COUNT] = { 0 };
+        for (uint32_t i = 0; i < LATENCY_BUCKET_COUNT; ++i) {
+            uint32_t upper_micros = (i + 1) * LATENCY_BUCKET_MICROS, log2_bucket = 0;
+            while (log2_bucket < LATENCY_LOG2_BUCKET_COUNT - 1 && upper_micros > (250u << log2_bucket)) {
+                ++log2_bucket;
+            }
+            log2_buckets[log2_bucket] += stage_histogram->buckets[i];
+        }
+        fprintf(out, "%-10s %8llu %9.2f %9.2f %9.2f %9.2f  ", latency_stage_names[stage],
+                (unsigned long long) stage_histogram->count, percentile_millis(stage_histogram, 0.5),
+                percentile_millis(stage_histogram, 0.9), percentile_millis(stage_histogram, 0.99),
+                (double) stage_histogram->max_micros / 1000);
+        for (int i = 0; i < LATENCY_LOG2_BUCKET_COUNT; ++i) {
+            fprintf(out, " %llu", (unsigned long long) log2_buckets[i]);
+        }
+        fprintf(out, "\n");
+    }
+    fflush(out);
+}
+
+void destroy_latency_histogram(LatencyHistogram *histogram) {
+    free(histogram);
+}
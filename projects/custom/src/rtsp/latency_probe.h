@@ -0,0 +1,74 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Glass-to-glass latency probe for hello_rtsp_server -> hello_rtsp_client on one machine.
+ * The server puts the wall-clock times of every access unit (captured, encoded, released to the RTP sink)
+ * into a user data unregistered SEI, the client adds its own (received, decoded, converted), both read the
+ * same gettimeofday clock, and the differences go into one histogram per stage.
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#ifndef LATENCY_PROBE_H
+#define LATENCY_PROBE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* NAL unit header, payload type and size, uuid, 3 stamps, trailing bits, and room for emulation prevention */
+#define LATENCY_SEI_MAX_SIZE 64
+
+typedef struct LatencyStamps {
+    int64_t captured_micros;
+    int64_t encoded_micros;
+    int64_t released_micros; /* 0 if unknown, e.g. the Annex-B delivery mode shares one copy with every client */
+} LatencyStamps;
+
+typedef enum LatencyStage {
+    LATENCY_STAGE_ENCODE,    /* captured -> encoded */
+    LATENCY_STAGE_QUEUE,     /* encoded -> released: fan-out ring and pacing */
+    LATENCY_STAGE_TRANSPORT, /* released -> received: packetize, network, jitter buffer and depacketize */
+    LATENCY_STAGE_DECODE,    /* received -> decoded */
+    LATENCY_STAGE_CONVERT,   /* decoded -> converted to the output pixel format */
+    LATENCY_STAGE_TOTAL,     /* captured -> converted */
+    LATENCY_STAGE_COUNT
+} LatencyStage;
+
+typedef struct LatencyHistogram LatencyHistogram;
+
+/** the clock both processes stamp with **/
+int64_t get_latency_clock_micros();
+/** writes the SEI NAL unit (no start code) to nal, returns its size **/
+uint32_t write_latency_sei(const LatencyStamps *stamps, uint8_t nal[LATENCY_SEI_MAX_SIZE]);
+/** false if nal is not a latency SEI **/
+bool read_latency_sei(const uint8_t *nal, uint32_t nal_size, LatencyStamps *stamps);
+
+LatencyHistogram *create_latency_histogram();
+void record_latency(LatencyHistogram *histogram, LatencyStage stage, int64_t micros);
+/** count, p50/p90/p99/max and a power-of-two bucket count per stage **/
+void print_latency_histogram(LatencyHistogram *histogram, FILE *out);
+void destroy_latency_histogram(LatencyHistogram *histogram);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LATENCY_PROBE_H */
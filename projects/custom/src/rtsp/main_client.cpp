@@ -21,6 +21,9 @@
 #include "rtsp_ffmpeg_client.h"
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
 
 static void on_frame_rtsp(uint8_t *data[8], int line_size[8],
                           uint32_t width, uint32_t height, int64_t pts_millis) {
@@ -29,18 +32,35 @@ static void on_frame_rtsp(uint8_t *data[8], int line_size[8],
     cv::waitKey(1);
 }
 
-static void test_rtsp() {
+static void test_rtsp(const char *rtspUrl, bool latencyReport, uint32_t reportEveryFrames) {
     cv::namedWindow("Image Window", cv::WINDOW_AUTOSIZE);
 
-    RtspClient *client = open_rtsp("rtsp://192.168.1.101:8554/testH264",
-                                   AV_PIX_FMT_BGR24, on_frame_rtsp);
+    RtspClient *client = open_rtsp(rtspUrl, AV_PIX_FMT_BGR24, on_frame_rtsp);
     if (client) {
+        if (latencyReport) {
+            enable_rtsp_latency_report(client, reportEveryFrames);
+        }
         loop_read_rtsp_frame(client);
         close_rtsp(client);
     }
 }
 
+// usage: hello_rtsp_client [-l report_every_frames] [rtsp_url]
+// against hello_rtsp_server -l on the same machine, -l reports the glass-to-glass latency per stage:
+//     hello_rtsp_server -l & hello_rtsp_client -l 250 rtsp://127.0.0.1:8554/testH264
 int main(int argc, char **argv) {
-    test_rtsp();
+    bool latencyReport = false;
+    uint32_t reportEveryFrames = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "l:")) != -1) {
+        if (opt == 'l') {
+            latencyReport = true;
+            reportEveryFrames = static_cast<uint32_t>(strtoul(optarg, nullptr, 10));
+        } else {
+            fprintf(stderr, "usage: %s [-l report_every_frames] [rtsp_url]\n", argv[0]);
+            return 1;
+        }
+    }
+    test_rtsp(optind < argc ? argv[optind] : "rtsp://192.168.1.101:8554/testH264", latencyReport, reportEveryFrames);
     return 0;
 }
\ No newline at end of file
@@ -20,221 +20,581 @@
  */
 #include "common.h"
 #include "x264_stream.h"
+#include "h264_nal.h"
 #include "ExchangerDeviceSource.hpp"
 #include "ExchangerH264VideoServerMediaSubsession.hpp"
+#include "ExchangerRateController.hpp"
+#include "encode_scheduler.h"
+#include "frame_pacer.h"
+#include "latency_probe.h"
 #include "BasicUsageEnvironment.hh"
 #include "liveMedia.hh"
+#include "../john_collections/john_slab_arena.h"
+#include "../john_collections/john_frame_queue.h"
+#include "../john_collections/john_fanout_ring.h"
+#include <atomic>
+#include <map>
+#include <vector>
 #include <pthread.h>
-#include <queue>
+#include <sys/time.h>
+#include <unistd.h>
 
-static void on_encoded_frame(uint8_t *payload, uint32_t size);
-static void *do_x264_encode(void *client);
+static void on_encoded_picture(const X264EncodedPicture *picture, void *client);
+static bool encode_next_frame(void *client, uint64_t tick);
 
-class ByteArray {
-public:
-    ByteArray(uint8_t *data, uint32_t size): data(data), size(size) { }
-    virtual ~ByteArray() = default;
-    uint8_t *data;
-    uint32_t size;
+// 2x2 box filter, the only scaling the half resolution tier needs
+static void downscale_i420_half(const uint8_t *frame, int width, int height, uint8_t *out) {
+    for (int plane = 0; plane < 3; ++plane) {
+        int planeWidth = plane ? width / 2 : width, planeHeight = plane ? height / 2 : height;
+        for (int y = 0; y < planeHeight / 2; ++y) {
+            const uint8_t *row0 = frame + 2 * y * planeWidth, *row1 = row0 + planeWidth;
+            for (int x = 0; x < planeWidth / 2; ++x) {
+                *out++ = static_cast<uint8_t>((row0[2 * x] + row0[2 * x + 1] + row1[2 * x] + row1[2 * x + 1] + 2) >> 2);
+            }
+        }
+        frame += planeWidth * planeHeight;
+    }
+}
+
+static void *retain_frame(void *frame, void *client) {
+    return john_slice_retain(static_cast<JohnSlice *>(frame));
+}
+
+static void release_frame(void *frame, void *client) {
+    john_slice_release(static_cast<JohnSlice *>(frame));
+}
+
+// slice layout: this header, then one access unit, as length prefixed NAL units in discrete NAL mode
+// or as the Annex-B byte stream otherwise
+struct AccessUnitHeader {
+    struct timeval presentationTime; // of its capture tick, see frame_pacer.h
+    uint64_t releaseNanos; // CLOCK_MONOTONIC, it does not go out earlier; 0 for right away
+    uint32_t durationMicros;
 };
 
-class SyncQueue {
+// one per device source, i.e. per client; every client reads the one encoder output through its own cursor
+struct ClientCursor {
+    JohnFanoutReader *reader;
+    JohnSlice *accessUnit; // being lent NAL unit by NAL unit, in discrete NAL mode
+    uint32_t accessUnitOffset;
+    AccessUnitHeader accessUnitTiming;
+    uint32_t burstFrames; // cached access units still to go out before the client plays live
+    int64_t burstMicros; // presentation time of the next of them
+    uint8_t latencySei[LATENCY_SEI_MAX_SIZE]; // the latency SEI being lent, stamped with its release time
+    bool playing; // a PLAY after PAUSE resumes from the cursor instead of bursting again
+};
+
+// the latency SEI goes into the Annex-B byte stream with the start code x264 gives its own NAL units
+static const uint8_t ANNEX_B_START_CODE[] = { 0, 0, 0, 1 };
+
+// the cached GOP is stamped this far apart, just before PLAY, so the client decodes it at once
+static const int64_t BURST_SPACING_MICROS = 1000;
+
+// one encoder per stream, started by the first client and stopped with the last one, so the encoding cost
+// does not grow with the number of viewers
+class MyDataDelegate: public ExchangerDataDelegate {
 public:
-    explicit SyncQueue(int capacity):queue(new std::queue<ByteArray *>()), capacity(capacity) {
-        pthread_mutex_init(&mutex, nullptr);
-        pthread_cond_init(&cond, nullptr);
+    // the encodes of every stream run on the workers of encodeScheduler, encoderThreads 0 lets x264 decide
+    MyDataDelegate(const char *yuvFile, bool discreteNals, ExchangerRateController *rateController,
+                   EncodeScheduler *encodeScheduler, int encoderThreads, bool latencyProbe)
+            : stream(nullptr), closed(true), discreteNals(discreteNals), latencyProbe(latencyProbe), captureMicros(),
+              rateController(rateController), appliedGeneration(0), resolutionTier(0),
+              tierFrame(new uint8_t[width * height * 3 / 2]),
+              arena(john_slab_arena_create(4096, 1024 * 1024, 32)),
+              // 6 seconds of frames; a client more than a second behind skips to the newest key frame
+              ring(john_fanout_ring_create(150, 25, retain_frame, release_frame, nullptr)),
+              yuvFile(yuvFile), file(nullptr), inputFrame(new uint8_t[width * height * 3 / 2]),
+              encodeScheduler(encodeScheduler), encodeStreamId(-1), idrWanted(false), idrForced(false) {
+        // zerolatency, sliced threads and intra refresh, with slices sized for one RTP packet each
+        x264_live_config_default(&config);
+        config.threads = encoderThreads;
+        // an access unit more than 4 frames late re-anchors the capture clock rather than bursting
+        pacer = create_frame_pacer(config.fps_num, config.fps_den, 4);
+        pthread_mutex_init(&parameterSetsMutex, nullptr);
+        // the encoder only runs while there are clients, but DESCRIBE comes first: open one for its headers only
+        if ((stream = create_x264_live_module(width, height, &config, nullptr))) {
+            keepParameterSets();
+            destroy_x264_module(stream);
+            stream = nullptr;
+        }
+    };
+    ~MyDataDelegate() override {
+        pthread_mutex_destroy(&parameterSetsMutex);
+        john_fanout_ring_destroy(ring);
+        destroy_frame_pacer(pacer);
+        john_slab_arena_destroy(arena);
+        delete[] tierFrame;
+        delete[] inputFrame;
     }
 
-    virtual ~SyncQueue() {
-        delete queue;
-        pthread_mutex_destroy(&mutex);
-        pthread_cond_destroy(&cond);
+    void onOpen(ExchangerDeviceSource *source) override {
+        LOGW("onOpen\n");
+        ClientCursor cursor = ClientCursor();
+        cursor.reader = john_fanout_ring_open_reader(ring);
+        clients[source] = cursor;
+        if (clients.size() == 1) {
+            startEncoder();
+        }
     }
 
-    ByteArray *push(ByteArray *frame) {
-        ByteArray *older = nullptr;
-        pthread_mutex_lock(&mutex);
-        LOGW("queue->size()=%lu\n", queue->size());
-        while (queue->size() >= capacity) {
-            older = queue->front();
-            queue->pop();
+    // the newest IDR and what followed it are still in the ring, so the client gets a full picture right away
+    // instead of waiting for the next key frame; they go out as fast as the network takes them. Only the first
+    // PLAY bursts: on a resume after PAUSE the client already decoded up to its cursor
+    void onStartPlaying(ExchangerDeviceSource *source) override {
+        auto client = clients.find(source);
+        if (client == clients.end() || client->second.playing) {
+            return;
         }
-        queue->push(frame);
-        pthread_cond_signal(&cond);
-        pthread_mutex_unlock(&mutex);
-        return older;
+        ClientCursor *cursor = &client->second;
+        cursor->playing = true;
+        cursor->burstFrames = john_fanout_ring_rewind_to_key(ring, cursor->reader);
+        if (cursor->burstFrames == 0) {
+            idrWanted = true;
+        }
+        struct timeval now;
+        gettimeofday(&now, nullptr);
+        cursor->burstMicros = static_cast<int64_t>(now.tv_sec) * 1000000 + now.tv_usec
+                              - cursor->burstFrames * BURST_SPACING_MICROS;
+        LOGW("bursting %u cached frames\n", cursor->burstFrames);
     }
 
-    ByteArray *pop() {
-        ByteArray *frame = nullptr;
-        pthread_mutex_lock(&mutex);
-        LOGW("queue->size()=%lu\n", queue->size());
-        while (queue->empty()) {
-            pthread_cond_wait(&cond, &mutex);
+    // a live access unit keeps the paced timing of its capture tick, a cached one goes out right away
+    static AccessUnitHeader stampAccessUnit(ClientCursor *cursor, const JohnSlice *accessUnit) {
+        AccessUnitHeader timing = *reinterpret_cast<const AccessUnitHeader *>(accessUnit->data);
+        if (cursor->burstFrames == 0) {
+            return timing;
         }
-        frame = queue->front();
-        queue->pop();
-        pthread_mutex_unlock(&mutex);
-        return frame;
+        --cursor->burstFrames;
+        timing.presentationTime.tv_sec = static_cast<time_t>(cursor->burstMicros / 1000000);
+        timing.presentationTime.tv_usec = static_cast<suseconds_t>(cursor->burstMicros % 1000000);
+        timing.releaseNanos = 0;
+        timing.durationMicros = 0;
+        cursor->burstMicros += BURST_SPACING_MICROS;
+        return timing;
     }
 
-    size_t size() {
-        size_t queue_size = 0;
-        pthread_mutex_lock(&mutex);
-        queue_size = queue->size();
-        pthread_mutex_unlock(&mutex);
-        return queue_size;
+    static void lendTiming(const AccessUnitHeader &timing, ExchangerBorrowedFrame *frame) {
+        frame->presentationTime = timing.presentationTime;
+        frame->releaseInMicroseconds = timing.releaseNanos ? get_release_delay_micros(timing.releaseNanos) : 0;
+        // the RTP sink adds up the durations of what it sends, so only the end of the access unit carries it
+        frame->durationInMicroseconds = frame->endsAccessUnit ? timing.durationMicros : 0;
     }
-private:
-    int capacity;
-    std::queue<ByteArray *> *queue;
-    pthread_mutex_t mutex;
-    pthread_cond_t cond;
-};
 
-class MyDataDelegate: public ExchangerDataDelegate {
-public:
-    MyDataDelegate(): stream(nullptr), queue(nullptr), closed(false), lastReadData(nullptr) { };
-    ~MyDataDelegate() override {
-        delete[] lastReadData;
+    bool getParameterSets(std::vector<uint8_t> &sps, std::vector<uint8_t> &pps) override {
+        pthread_mutex_lock(&parameterSetsMutex);
+        sps = this->sps;
+        pps = this->pps;
+        pthread_mutex_unlock(&parameterSetsMutex);
+        return !sps.empty() && !pps.empty();
     }
 
-    void onOpen(ExchangerDeviceSource *source) override {
-        LOGW("onOpen\n");
-        closed = false;
-        queue = new SyncQueue(500);
-        if (!(stream = create_x264_module(width, height, nullptr, nullptr, on_encoded_frame))) {
-            LOGW("create_x264_module failed!\n");
+    // on the encoder side, whenever a new encoder is opened
+    void keepParameterSets() {
+        const uint8_t *spsData, *ppsData;
+        uint32_t spsSize, ppsSize;
+        if (get_x264_parameter_sets(stream, &spsData, &spsSize, &ppsData, &ppsSize) < 0) {
+            LOGW("get_x264_parameter_sets failed!\n");
+            return;
         }
-        pthread_create(&pthread, nullptr, do_x264_encode, this);
+        pthread_mutex_lock(&parameterSetsMutex);
+        sps.assign(spsData, spsData + spsSize);
+        pps.assign(ppsData, ppsData + ppsSize);
+        pthread_mutex_unlock(&parameterSetsMutex);
     }
 
     bool readDataSync(ExchangerDeviceSource *source, uint8_t **data, uint32_t *size) override {
-        LOGW("readDataSync\n");
-        if (closed) {
-            return false;
+        // every frame is lent, see tryBorrowFrame()
+        return false;
+    }
+
+    ExchangerReadResult tryBorrowFrame(ExchangerDeviceSource *source, ExchangerBorrowedFrame *frame) override {
+        auto client = clients.find(source);
+        if (client == clients.end() || closed) {
+            return EXCHANGER_READ_CLOSED;
         }
-        if (lastReadData) {
-            delete[] lastReadData;
-            lastReadData = nullptr;
+        if (discreteNals) {
+            return borrowNal(&client->second, frame);
         }
-        ByteArray *byteArray = queue->pop();
-        if (byteArray) {
-            *data = byteArray->data;
-            *size = byteArray->size;
-            delete byteArray;
-            lastReadData = *data;
-            return true;
+        JohnSlice *slice = readAccessUnit(&client->second);
+        if (!slice) {
+            return EXCHANGER_READ_AGAIN;
         }
-        return false;
+        // the source copies it downstream and hands the reference back through releaseFrame()
+        frame->data = slice->data + sizeof(AccessUnitHeader);
+        frame->dataSize = slice->size - static_cast<uint32_t>(sizeof(AccessUnitHeader));
+        frame->endsAccessUnit = true;
+        lendTiming(stampAccessUnit(&client->second, slice), frame);
+        frame->handle = slice;
+        return EXCHANGER_READ_OK;
+    }
+
+    // a reader waiting for a key frame would otherwise wait for the next one the encoder decides on, which with
+    // intra refresh is never
+    JohnSlice *readAccessUnit(ClientCursor *cursor) {
+        JohnSlice *accessUnit = static_cast<JohnSlice *>(john_fanout_ring_read(ring, cursor->reader, nullptr));
+        if (!accessUnit && john_fanout_ring_is_waiting_for_key(ring, cursor->reader)) {
+            idrWanted = true;
+        }
+        return accessUnit;
+    }
+
+    // lends the access unit one NAL unit at a time, each holding its own reference to the slice
+    ExchangerReadResult borrowNal(ClientCursor *cursor, ExchangerBorrowedFrame *frame) {
+        if (!cursor->accessUnit) {
+            cursor->accessUnit = readAccessUnit(cursor);
+            if (!cursor->accessUnit) {
+                return EXCHANGER_READ_AGAIN;
+            }
+            cursor->accessUnitOffset = sizeof(AccessUnitHeader);
+            cursor->accessUnitTiming = stampAccessUnit(cursor, cursor->accessUnit);
+        }
+        JohnSlice *accessUnit = cursor->accessUnit;
+        const uint8_t *nal = accessUnit->data + cursor->accessUnitOffset;
+        uint32_t nalSize = H264_NAL_READ_LENGTH(nal);
+        cursor->accessUnitOffset += H264_NAL_LENGTH_SIZE + nalSize;
+        frame->data = const_cast<uint8_t *>(nal) + H264_NAL_LENGTH_SIZE;
+        frame->dataSize = nalSize;
+        frame->endsAccessUnit = cursor->accessUnitOffset >= accessUnit->size;
+        lendTiming(cursor->accessUnitTiming, frame);
+        // the restamped SEI is lent from the cursor, the source copies it out before the next borrow
+        frame->handle = latencyProbe && restampLatencySei(cursor, frame) ? nullptr : john_slice_retain(accessUnit);
+        if (frame->endsAccessUnit) {
+            john_slice_release(accessUnit);
+            cursor->accessUnit = nullptr;
+        }
+        return EXCHANGER_READ_OK;
+    }
+
+    // every client gets the access unit at its own time, so each one gets its own copy of the latency SEI
+    static bool restampLatencySei(ClientCursor *cursor, ExchangerBorrowedFrame *frame) {
+        LatencyStamps stamps;
+        if (!read_latency_sei(frame->data, frame->dataSize, &stamps)) {
+            return false;
+        }
+        stamps.released_micros = get_latency_clock_micros() + frame->releaseInMicroseconds;
+        frame->dataSize = write_latency_sei(&stamps, cursor->latencySei);
+        frame->data = cursor->latencySei;
+        return true;
+    }
+
+    void releaseFrame(ExchangerDeviceSource *source, ExchangerBorrowedFrame *frame) override {
+        john_slice_release(static_cast<JohnSlice *>(frame->handle));
+    }
+
+    // on a scheduler worker, once per tick; false ends the stream
+    bool encodeNextFrame(uint64_t tick) {
+        if (closed || fread(inputFrame, 1, width * height * 3 / 2, file) != width * height * 3 / 2) {
+            return false;
+        }
+        // the tick is the capture time of the frame, it comes back as the pts of the encoded picture
+        captureMicros[tick % CAPTURE_STAMPS] = get_latency_clock_micros();
+        appendYuvData(inputFrame, static_cast<int64_t>(tick));
+        return true;
     }
 
-    void appendYuvData(uint8_t *frame) {
+    void appendYuvData(uint8_t *frame, int64_t pts) {
         LOGW("appendYuvData\n");
         if (closed) {
             return;
         }
-        if (append_i420_frame(stream, frame) < 0) {
-            LOGW("append_i420_frame failed!\n");
+        applyRateTarget();
+        if (!stream) {
+            return;
+        }
+        int tierWidth = width >> resolutionTier, tierHeight = height >> resolutionTier;
+        if (resolutionTier) {
+            downscale_i420_half(frame, width, height, tierFrame);
+            frame = tierFrame;
+        }
+        if (idrWanted && !idrForced) {
+            request_x264_idr(stream);
+            idrForced = true;
+        }
+        // the encoder reads the planes straight from the capture buffer
+        uint8_t *planes[3] = { frame, frame + tierWidth * tierHeight, frame + tierWidth * tierHeight * 5 / 4 };
+        int strides[3] = { tierWidth, tierWidth / 2, tierWidth / 2 };
+        if (append_i420_planes(stream, planes, strides, pts) < 0) {
+            LOGW("append_i420_planes failed!\n");
         }
     }
 
-    void write264Data(uint8_t *frame, uint32_t size) {
-        LOGW("write264Data %u\n", size);
-        if (closed) {
+    // on the encoder thread, between two frames
+    void applyRateTarget() {
+        if (!rateController) {
             return;
         }
-        ByteArray *older = queue->push(new ByteArray(frame, size));
-        if (older) {
-            delete[] older->data;
-            delete older;
+        ExchangerRateTarget target = rateController->getTarget();
+        if (target.generation == appliedGeneration) {
+            return;
+        }
+        appliedGeneration = target.generation;
+        config.bitrate_kbps = target.bitrateKbps;
+        if (target.resolutionTier != resolutionTier || !stream) {
+            // x264 cannot change the picture size in place, the new encoder starts with SPS/PPS and an IDR
+            if (stream) {
+                encode_x264_frame(stream);
+                destroy_x264_module(stream);
+                stream = nullptr;
+            }
+            resolutionTier = target.resolutionTier;
+            openEncoder();
+        } else if (reconfigure_x264_bitrate(stream, target.bitrateKbps, 0) < 0) {
+            LOGW("reconfigure_x264_bitrate failed!\n");
         }
     }
 
-    void onClose(ExchangerDeviceSource *source) override {
-        LOGW("onClose\n");
+    void openEncoder() {
+        if (!(stream = create_x264_live_module(width >> resolutionTier, height >> resolutionTier,
+                                               &config, nullptr))) {
+            LOGW("create_x264_live_module failed!\n");
+        } else {
+            set_x264_picture_callback(stream, on_encoded_picture, this);
+            keepParameterSets();
+        }
+    }
+
+    void writeEncodedPicture(const X264EncodedPicture *picture) {
+        LOGW("writeEncodedPicture %u\n", picture->size);
         if (closed) {
             return;
         }
-        closed = true;
-        pthread_join(pthread, nullptr);
-        if (encode_x264_frame(stream) < 0) {
-            LOGW("encode_x264_frame failed!\n");
+        // with intra refresh the recovery point pictures are key frames to x264 too, but they need the ones before
+        // them; the ring starts readers at IDRs only, and those are forced when a reader waits for one
+        JohnFramePriority priority = picture->idr ? JOHN_FRAME_KEY : JOHN_FRAME_NON_REFERENCE;
+        if (picture->idr) {
+            idrWanted = false;
+            idrForced = false;
         }
-        destroy_x264_module(stream);
-        ByteArray *array;
-        while (queue->size() > 0) {
-            array = queue->pop();
-            if (array) {
-                delete[] array->data;
-                delete array;
+        uint8_t sei[LATENCY_SEI_MAX_SIZE];
+        uint32_t seiSize = 0;
+        if (latencyProbe) {
+            LatencyStamps stamps = LatencyStamps();
+            stamps.captured_micros = captureMicros[static_cast<uint64_t>(picture->pts) % CAPTURE_STAMPS];
+            stamps.encoded_micros = get_latency_clock_micros();
+            seiSize = write_latency_sei(&stamps, sei);
+        }
+        uint32_t nalsSize = seiSize ? H264_NAL_LENGTH_SIZE + seiSize : 0;
+        for (int i = 0; i < picture->nal_count; ++i) {
+            const X264EncodedNal *nal = &picture->nals[i];
+            nalsSize += H264_NAL_LENGTH_SIZE + nal->size - nal->start_code_size;
+            if (priority == JOHN_FRAME_NON_REFERENCE && nal->type == H264_NAL_SLICE && nal->ref_idc != 0) {
+                priority = JOHN_FRAME_REFERENCE;
             }
         }
-        delete queue;
+        // x264 reuses its payload buffer, so this is the one copy an encoded frame gets
+        uint32_t annexBSize = picture->size + (seiSize ? sizeof(ANNEX_B_START_CODE) + seiSize : 0);
+        JohnSlice *frame = john_slab_arena_alloc(arena, sizeof(AccessUnitHeader)
+                                                        + (discreteNals ? nalsSize : annexBSize));
+        if (!frame) {
+            LOGW("john_slab_arena_alloc failed!\n");
+            return;
+        }
+        // the capture clock, not the encoder or the queue, decides when the access unit goes out
+        PacedFrame paced;
+        pace_frame(pacer, picture->pts, &paced);
+        auto *header = reinterpret_cast<AccessUnitHeader *>(frame->data);
+        header->presentationTime = paced.presentation_time;
+        header->releaseNanos = paced.release_nanos;
+        header->durationMicros = paced.duration_micros;
+        if (discreteNals) {
+            // x264 knows the NAL unit boundaries, so the event loop only follows the length prefixes
+            uint8_t *out = frame->data + sizeof(AccessUnitHeader);
+            for (int i = 0; i < picture->nal_count; ++i) {
+                const X264EncodedNal *nal = &picture->nals[i];
+                if (seiSize && isFirstSlice(picture, i)) {
+                    H264_NAL_WRITE_LENGTH(out, seiSize);
+                    memcpy(out + H264_NAL_LENGTH_SIZE, sei, seiSize);
+                    out += H264_NAL_LENGTH_SIZE + seiSize;
+                }
+                uint32_t nalSize = nal->size - nal->start_code_size;
+                H264_NAL_WRITE_LENGTH(out, nalSize);
+                memcpy(out + H264_NAL_LENGTH_SIZE, nal->payload + nal->start_code_size, nalSize);
+                out += H264_NAL_LENGTH_SIZE + nalSize;
+            }
+        } else if (seiSize) {
+            uint8_t *out = frame->data + sizeof(AccessUnitHeader);
+            int firstSlice = 0;
+            while (firstSlice < picture->nal_count && !isFirstSlice(picture, firstSlice)) {
+                ++firstSlice;
+            }
+            uint32_t headSize = firstSlice < picture->nal_count
+                                ? static_cast<uint32_t>(picture->nals[firstSlice].payload - picture->nals[0].payload)
+                                : picture->size;
+            memcpy(out, picture->nals[0].payload, headSize);
+            out += headSize;
+            memcpy(out, ANNEX_B_START_CODE, sizeof(ANNEX_B_START_CODE));
+            memcpy(out + sizeof(ANNEX_B_START_CODE), sei, seiSize);
+            out += sizeof(ANNEX_B_START_CODE) + seiSize;
+            memcpy(out, picture->nals[0].payload + headSize, picture->size - headSize);
+        } else {
+            memcpy(frame->data + sizeof(AccessUnitHeader), picture->nals[0].payload, picture->size);
+        }
+        // a client that lags behind skips ahead to a key frame, see john_fanout_ring.h
+        john_fanout_ring_publish(ring, frame, picture->size, priority);
+        ExchangerDeviceSource::signalNewFrames(this);
     }
 
-    bool isClosed() {
-        return closed;
+    // an SEI has to come before the first slice of its access unit
+    static bool isFirstSlice(const X264EncodedPicture *picture, int index) {
+        for (int i = 0; i <= index; ++i) {
+            int type = picture->nals[i].type;
+            if (type == H264_NAL_SLICE || type == H264_NAL_IDR) {
+                return i == index;
+            }
+        }
+        return false;
     }
 
-    size_t getDelay() {
-        if (closed) {
-            return 0;
+    void onClose(ExchangerDeviceSource *source) override {
+        LOGW("onClose\n");
+        auto client = clients.find(source);
+        if (client == clients.end()) {
+            return;
+        }
+        JohnFanoutReaderStats stats;
+        john_fanout_ring_get_reader_stats(ring, client->second.reader, &stats);
+        LOGW("client read %llu frames, skipped %llu frames in %llu jumps to a key frame\n",
+             (unsigned long long) stats.read_frames, (unsigned long long) stats.skipped_frames,
+             (unsigned long long) stats.key_jumps);
+        john_slice_release(client->second.accessUnit);
+        john_fanout_ring_close_reader(ring, client->second.reader);
+        clients.erase(client);
+        if (clients.empty()) {
+            stopEncoder();
+        }
+    }
+
+    void startEncoder() {
+        closed = false;
+        if (rateController) {
+            ExchangerRateTarget target = rateController->getTarget();
+            appliedGeneration = target.generation;
+            resolutionTier = target.resolutionTier;
+            config.bitrate_kbps = target.bitrateKbps;
+        }
+        openEncoder();
+        if (!(file = fopen(yuvFile, "r"))) {
+            LOGW("fopen %s failed!\n", yuvFile);
+            return;
+        }
+        // paced at the stream frame rate by the scheduler clock instead of sleeping on the queue depth
+        encodeStreamId = add_encode_stream(encodeScheduler, encode_next_frame, this);
+    }
+
+    void stopEncoder() {
+        closed = true;
+        // waits for an encode still running on a worker
+        remove_encode_stream(encodeScheduler, encodeStreamId);
+        encodeStreamId = -1;
+        if (file) {
+            fclose(file);
+            file = nullptr;
+        }
+        if (stream && encode_x264_frame(stream) < 0) {
+            LOGW("encode_x264_frame failed!\n");
         }
-        return queue->size() / 100;
+        destroy_x264_module(stream);
+        stream = nullptr;
+        // the next first client starts from the new encoder's first key frame
+        john_fanout_ring_clear(ring);
+        LOGW("the capture clock was re-anchored %llu times\n",
+             (unsigned long long) get_frame_pacer_reanchors(pacer));
+        reset_frame_pacer(pacer);
     }
+
 private:
-    bool closed;
-    pthread_t pthread;
+    bool closed; // no client, the encoder is stopped
     X264Stream *stream;
-    SyncQueue *queue;
-    uint8_t *lastReadData;
+    std::map<ExchangerDeviceSource *, ClientCursor> clients; // event loop thread only
+    bool discreteNals;
+    bool latencyProbe; // every access unit carries a latency SEI, see latency_probe.h
+    static const uint64_t CAPTURE_STAMPS = 8; // more than the frames x264 holds back with zerolatency
+    int64_t captureMicros[CAPTURE_STAMPS]; // by capture tick, until the encoder hands the picture back
+    ExchangerRateController *rateController;
+    X264LiveConfig config;
+    unsigned appliedGeneration;
+    int resolutionTier; // 1 encodes at half width and height from tierFrame
+    uint8_t *tierFrame;
+    JohnSlabArena *arena;
+    JohnFanoutRing *ring;
+    FramePacer *pacer; // maps the capture ticks of the encoder to presentation and release times
+    std::vector<uint8_t> sps; // of the encoder opened last, see getParameterSets()
+    std::vector<uint8_t> pps;
+    pthread_mutex_t parameterSetsMutex;
+    // ffmpeg -i data/cuc_ieschool.mp4 -c:v rawvideo -pix_fmt yuv420p data/cuc_ieschool.yuv
+    const char *yuvFile;
+    FILE *file;
+    uint8_t *inputFrame;
+    EncodeScheduler *encodeScheduler;
+    int encodeStreamId;
+    std::atomic<bool> idrWanted; // set on the event loop when a reader has no IDR to start from
+    bool idrForced; // on the encoder side, the requested IDR is on its way
     static const int width = 512, height = 288;
 };
 
-static void on_encoded_frame(uint8_t *payload, uint32_t size) {
-    uint8_t *data = new uint8_t[size];
-    memcpy(data, payload, size);
-    dynamic_cast<MyDataDelegate *>(ExchangerDeviceSource::dataDelegate)->write264Data(data, size);
+static void on_encoded_picture(const X264EncodedPicture *picture, void *client) {
+    static_cast<MyDataDelegate *>(client)->writeEncodedPicture(picture);
 }
 
-static void *do_x264_encode(void *client) {
-    MyDataDelegate *delegate = static_cast<MyDataDelegate *>(client);
-    // ffmpeg -i data/cuc_ieschool.mp4 -c:v rawvideo -pix_fmt yuv420p data/cuc_ieschool.yuv
-    const char *yuv_file = "data/cuc_ieschool.yuv";
-    size_t frame_size = 512 * 288 * 3 / 2;
-    uint8_t *frame = new uint8_t[frame_size];
-    FILE *file = fopen(yuv_file, "r");
-    size_t delay;
-    while (!delegate->isClosed() && fread(frame, 1, frame_size, file) == frame_size) {
-        delegate->appendYuvData(frame);
-        delay = delegate->getDelay();
-        if (delay != 0) {
-            usleep(static_cast<useconds_t>(delay * 50000));
-        }
-    }
-    return nullptr;
+static bool encode_next_frame(void *client, uint64_t tick) {
+    return static_cast<MyDataDelegate *>(client)->encodeNextFrame(tick);
 }
 
-static void video_server_start() {
+// every stream has its own delegate, encoder and rate controller; the encodes share one worker per cpu
+static void video_server_start(int streamCount, char **streamNames, bool latencyProbe) {
     TaskScheduler *scheduler = BasicTaskScheduler::createNew();
     UsageEnvironment *environment = BasicUsageEnvironment::createNew(*scheduler);
     RTSPServer *rtspServer = RTSPServer::createNew(*environment, 8554);
 
-    ExchangerDeviceSource::dataDelegate = new MyDataDelegate();
+    // x264 hands out whole NAL units, so let the device source lend them one by one instead of
+    // having H264VideoStreamFramer parse them back out of a byte stream
+    const Boolean discreteNals = True;
+    // a discrete NAL unit is delivered whole, an IDR slice easily exceeds the default 60000 bytes
+    OutPacketBuffer::maxSize = 512 * 1024;
+    EncodeScheduler *encodeScheduler = create_encode_scheduler(0, 25, 1);
+    // one encoder per worker once the streams outnumber the cpus, sliced threads would only oversubscribe them
+    int encoderThreads = streamCount > 1 ? 1 : 0;
+
+    for (int i = 0; i < streamCount; ++i) {
+        // fed by the receiver reports of every client of the stream, polled by its encodes
+        auto *rateController = new ExchangerRateController(200, 1500, 800);
+        auto *dataDelegate = new MyDataDelegate("data/cuc_ieschool.yuv", discreteNals, rateController,
+                                                encodeScheduler, encoderThreads, latencyProbe);
 
-    ServerMediaSession *sms = ServerMediaSession::createNew(*environment, "testH264", "testH264");
-    sms->addSubsession(ExchangerH264VideoServerMediaSubsession::createNew(*environment, False));
-    rtspServer->addServerMediaSession(sms);
+        ServerMediaSession *sms = ServerMediaSession::createNew(*environment, streamNames[i], streamNames[i]);
+        ExchangerH264VideoServerMediaSubsession *subsession =
+                ExchangerH264VideoServerMediaSubsession::createNew(*environment, False, dataDelegate, discreteNals);
+        subsession->setRateController(rateController);
+        sms->addSubsession(subsession);
+        rtspServer->addServerMediaSession(sms);
 
-    char* url = rtspServer->rtspURL(sms);
-    *environment << "Play this stream using the URL \"" << url << "\"\n";
-    delete[] url;
+        char* url = rtspServer->rtspURL(sms);
+        *environment << "Play this stream using the URL \"" << url << "\"\n";
+        delete[] url;
+    }
 
     environment->taskScheduler().doEventLoop();
 }
 
+// usage: hello_rtsp_server [-l] [stream_name ...], serves a single "testH264" without any;
+// -l stamps every access unit with a latency SEI for hello_rtsp_client -l
 int main(int argc, char **argv) {
-    video_server_start();
+    static char defaultName[] = "testH264";
+    static char *defaultNames[] = { defaultName };
+    bool latencyProbe = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "l")) != -1) {
+        if (opt == 'l') {
+            latencyProbe = true;
+        } else {
+            fprintf(stderr, "usage: %s [-l] [stream_name ...]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (optind < argc) {
+        video_server_start(argc - optind, argv + optind, latencyProbe);
+    } else {
+        video_server_start(1, defaultNames, latencyProbe);
+    }
     return 0;
 }
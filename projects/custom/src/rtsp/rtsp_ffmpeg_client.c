@@ -22,20 +22,72 @@
 #include <libavformat/avformat.h>
 #include <libavutil/imgutils.h>
 #include <libswscale/swscale.h>
+#include "frame_converter.h"
+#include <pthread.h>
+#include <stdatomic.h>
 #include "common.h"
 #include "rtsp_ffmpeg_client.h"
+#include "h264_nal.h"
+#include "latency_probe.h"
+#include "../john_collections/john_frame_queue.h"
+#include "../john_collections/john_synchronized_queue.h"
+
+/* packets wait here for the decoder; on overflow the demuxer never blocks, it drops by reference priority */
+#define PACKET_QUEUE_CAPACITY 64
+/* decoded pictures wait here for conversion and delivery; on overflow the oldest one is dropped */
+#define FRAME_QUEUE_CAPACITY 4
+/* how long a stage waits on its input before it looks whether the stage before it ended */
+#define STAGE_POLL_MILLIS 100
+
+/* the server stamps of a packet, until the picture decoded from it comes out of the decoder */
+typedef struct LatencyPending {
+    int64_t pts;
+    int64_t received_micros;
+    LatencyStamps stamps;
+    bool valid;
+} LatencyPending;
+
+/* more than the pictures the decoder holds back */
+#define LATENCY_PENDING_SIZE 16
 
 struct RtspClient {
     FrameCallback frame_callback;
-    enum AVPixelFormat pixel_format;
+    AVFrameCallback av_frame_callback;
+    void *user_params;
+    enum AVPixelFormat pixel_format; /* AV_PIX_FMT_NONE keeps the decoder output format */
+    int width; /* 0 keeps the decoder output width */
+    int height;
     AVFormatContext *format_context;
     int video_stream_index;
     AVCodecContext *codec_context;
     AVCodec *codec;
-    struct SwsContext *sws_context;
+    FrameConverter *converter; /* convert thread only, only used while the output differs from the decoder's */
+    AVBufferPool *frame_pool;
+    int frame_pool_size;
+    JohnFrameQueue *packet_queue; /* demux -> decode */
+    JohnSynchronizedQueue *frame_queue; /* decode -> convert */
+    atomic_bool stopping; /* a stage failed, the others end too */
+    atomic_bool demux_ended;
+    atomic_bool decode_ended;
+    uint64_t dropped_frames; /* decode thread only */
+    pthread_mutex_t latency_mutex; /* the pending stamps are kept by the demuxer and matched by the converter */
+    LatencyHistogram *latency_histogram; /* NULL unless enable_rtsp_latency_report() */
+    uint32_t latency_report_every;
+    uint32_t latency_frames;
+    uint32_t latency_next_pending;
+    LatencyPending latency_pending[LATENCY_PENDING_SIZE];
 };
 
 RtspClient *open_rtsp(const char *rtsp_url, enum AVPixelFormat pixel_format, FrameCallback frame_callback) {
+    RtspClient *client = open_rtsp_frames(rtsp_url, pixel_format, 0, 0, NULL, NULL);
+    if (client) {
+        client->frame_callback = frame_callback;
+    }
+    return client;
+}
+
+RtspClient *open_rtsp_frames(const char *rtsp_url, enum AVPixelFormat pixel_format, int width, int height,
+                             AVFrameCallback frame_callback, void *user_params) {
     LOGW("open_rtsp!\n");
     if (!rtsp_url) {
         LOGW("rtsp_url == NULL!\n");
@@ -48,12 +100,16 @@ RtspClient *open_rtsp(const char *rtsp_url, enum AVPixelFormat pixel_format, Fra
         return NULL;
     }
     memset(client, 0, sizeof(RtspClient));
+    pthread_mutex_init(&client->latency_mutex, NULL);
 
     av_register_all();
     avcodec_register_all();
 
     client->pixel_format = pixel_format;
-    client->frame_callback = frame_callback;
+    client->width = width;
+    client->height = height;
+    client->av_frame_callback = frame_callback;
+    client->user_params = user_params;
 
     avformat_network_init();
     if (avformat_open_input(&client->format_context, rtsp_url, NULL, NULL)) {
@@ -94,115 +150,344 @@ RtspClient *open_rtsp(const char *rtsp_url, enum AVPixelFormat pixel_format, Fra
     }
     av_codec_set_pkt_timebase(client->codec_context, video_stream->time_base);
 
+    /* the decode stage has its own thread, frame threading spreads it over the remaining cores */
+    client->codec_context->thread_count = 0;
+    client->codec_context->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
     if (avcodec_open2(client->codec_context, client->codec, NULL)) {
         LOGW("avcodec_open2 failed!\n");
         return NULL;
     }
 
-    client->sws_context = sws_getContext(client->codec_context->width, client->codec_context->height,
-                                         client->codec_context->pix_fmt, client->codec_context->width,
-                                         client->codec_context->height, client->pixel_format,
-                                         SWS_BICUBIC, NULL, NULL, NULL);
-    if (!client->sws_context) {
-        LOGW("sws_getContext failed!\n");
+    /* one slice per cpu, e.g. BGR24 at 1080p is too much for one core next to the decoder */
+    client->converter = create_frame_converter(0, SWS_BICUBIC);
+    if (!client->converter) {
+        LOGW("create_frame_converter failed!\n");
         return NULL;
     }
 
     return client;
 }
 
-void loop_read_rtsp_frame(RtspClient *client) {
-    LOGW("loop_read_rtsp_frame!\n");
+void enable_rtsp_latency_report(RtspClient *client, uint32_t report_every_frames) {
     if (!client) {
         LOGW("client == NULL!\n");
         return;
     }
-
-    AVFrame *frame_decoded = av_frame_alloc();
-    if (!frame_decoded) {
-        LOGW("av_frame_alloc failed!\n");
+    if (!client->latency_histogram && !(client->latency_histogram = create_latency_histogram())) {
+        LOGW("create_latency_histogram failed!\n");
         return;
     }
-    AVFrame *frame_result = av_frame_alloc();
-    if (!frame_result) {
-        LOGW("av_frame_alloc failed!\n");
+    client->latency_report_every = report_every_frames;
+}
+
+static void keep_latency_stamps(RtspClient *client, const AVPacket *packet, int64_t received_micros) {
+    const uint8_t *cursor = packet->data, *end = packet->data + packet->size, *nal;
+    uint32_t nal_size;
+    LatencyStamps stamps;
+    while ((nal = h264_next_nal(&cursor, end, &nal_size))) {
+        if (read_latency_sei(nal, nal_size, &stamps)) {
+            pthread_mutex_lock(&client->latency_mutex);
+            LatencyPending *pending = &client->latency_pending[client->latency_next_pending];
+            pending->pts = packet->pts;
+            pending->received_micros = received_micros;
+            pending->stamps = stamps;
+            pending->valid = true;
+            client->latency_next_pending = (client->latency_next_pending + 1) % LATENCY_PENDING_SIZE;
+            pthread_mutex_unlock(&client->latency_mutex);
+            return;
+        }
+    }
+}
+
+/* on the convert thread */
+static void record_latency_stamps(RtspClient *client, int64_t pts, int64_t decoded_micros, int64_t converted_micros) {
+    LatencyPending pending = { .valid = false };
+    pthread_mutex_lock(&client->latency_mutex);
+    for (int i = 0; i < LATENCY_PENDING_SIZE; ++i) {
+        if (client->latency_pending[i].valid && client->latency_pending[i].pts == pts) {
+            pending = client->latency_pending[i];
+            client->latency_pending[i].valid = false;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&client->latency_mutex);
+    if (!pending.valid) {
         return;
     }
+    LatencyHistogram *histogram = client->latency_histogram;
+    const LatencyStamps *stamps = &pending.stamps;
+    record_latency(histogram, LATENCY_STAGE_ENCODE, stamps->encoded_micros - stamps->captured_micros);
+    if (stamps->released_micros) {
+        record_latency(histogram, LATENCY_STAGE_QUEUE, stamps->released_micros - stamps->encoded_micros);
+        record_latency(histogram, LATENCY_STAGE_TRANSPORT, pending.received_micros - stamps->released_micros);
+    } else {
+        /* the queue is not known apart from the transport */
+        record_latency(histogram, LATENCY_STAGE_TRANSPORT, pending.received_micros - stamps->encoded_micros);
+    }
+    record_latency(histogram, LATENCY_STAGE_DECODE, decoded_micros - pending.received_micros);
+    record_latency(histogram, LATENCY_STAGE_CONVERT, converted_micros - decoded_micros);
+    record_latency(histogram, LATENCY_STAGE_TOTAL, converted_micros - stamps->captured_micros);
+    if (client->latency_report_every && ++client->latency_frames % client->latency_report_every == 0) {
+        print_latency_histogram(histogram, stdout);
+    }
+}
+
+static void free_packet(void *data, void *user_client_params) {
+    AVPacket *packet = (AVPacket *) data;
+    av_packet_free(&packet);
+}
+
+static void free_frame(void *data, void *user_client_params) {
+    AVFrame *frame = (AVFrame *) data;
+    av_frame_free(&frame);
+}
+
+/* a decoded picture has nothing depending on it, so the oldest one makes room for the newest */
+static void enqueue_decoded_frame(RtspClient *client, AVFrame *frame) {
+    while (!john_synchronized_queue_enqueue(client->frame_queue, frame, 0)) {
+        AVFrame *oldest = (AVFrame *) john_synchronized_queue_dequeue(client->frame_queue, 0);
+        if (oldest) {
+            av_frame_free(&oldest);
+            ++client->dropped_frames;
+        }
+    }
+}
+
+/* returns false when the decoder failed */
+static bool receive_decoded_frames(RtspClient *client) {
+    for (;;) {
+        AVFrame *frame = av_frame_alloc();
+        if (!frame) {
+            LOGW("av_frame_alloc failed!\n");
+            return false;
+        }
+        if (avcodec_receive_frame(client->codec_context, frame) < 0) {
+            av_frame_free(&frame);
+            return true;
+        }
+        if (client->latency_histogram) {
+            /* ours to use, the decoder only copies it from the codec context */
+            frame->reordered_opaque = get_latency_clock_micros();
+        }
+        enqueue_decoded_frame(client, frame);
+    }
+}
+
+/* the decode stage: packets from the demuxer in, decoded pictures out */
+static void *decode_rtsp_packets(void *params) {
+    RtspClient *client = (RtspClient *) params;
+    bool failed = false;
+    while (!failed && !atomic_load(&client->stopping)) {
+        AVPacket *packet = (AVPacket *) john_frame_queue_dequeue(client->packet_queue, STAGE_POLL_MILLIS);
+        if (!packet) {
+            if (atomic_load(&client->demux_ended) && john_frame_queue_size(client->packet_queue) == 0) {
+                break;
+            }
+            continue;
+        }
+        if (avcodec_send_packet(client->codec_context, packet)) {
+            LOGW("avcodec_send_packet failed!\n");
+            failed = true;
+        } else {
+            failed = !receive_decoded_frames(client);
+        }
+        av_packet_free(&packet);
+    }
+    if (!failed) {
+        /* the pictures frame threading still holds */
+        avcodec_send_packet(client->codec_context, NULL);
+        receive_decoded_frames(client);
+    } else {
+        atomic_store(&client->stopping, true);
+    }
+    atomic_store(&client->decode_ended, true);
+    return NULL;
+}
 
-    frame_result->format = client->pixel_format;
-    frame_result->width = client->codec_context->width;
-    frame_result->height = client->codec_context->height;
-    int buffer_size = av_image_get_buffer_size(client->pixel_format, client->codec_context->width,
-                                               client->codec_context->height, 1);
+/* converted frames come from a pool sized for the output, so they can be refcounted like decoded ones */
+static AVFrame *alloc_pooled_frame(RtspClient *client, enum AVPixelFormat format, int width, int height) {
+    int buffer_size = av_image_get_buffer_size(format, width, height, 1);
     if (buffer_size <= 0) {
         LOGW("av_image_get_buffer_size failed!\n");
-        return;
+        return NULL;
     }
-    uint8_t *buffer = (uint8_t *)av_malloc((size_t) buffer_size);
-    if (!buffer) {
-        LOGW("av_malloc failed!\n");
-        return;
+    if (buffer_size != client->frame_pool_size) {
+        /* buffers still held by consumers outlive the old pool */
+        av_buffer_pool_uninit(&client->frame_pool);
+        client->frame_pool = av_buffer_pool_init(buffer_size, NULL);
+        client->frame_pool_size = client->frame_pool ? buffer_size : 0;
     }
-    if (av_image_fill_arrays(frame_result->data, frame_result->linesize, buffer, client->pixel_format,
-                             client->codec_context->width, client->codec_context->height, 1) < 0) {
-        LOGW("av_image_fill_arrays failed!\n");
-        return;
+    AVFrame *frame = av_frame_alloc();
+    if (!frame) {
+        LOGW("av_frame_alloc failed!\n");
+        return NULL;
+    }
+    if (!client->frame_pool || !(frame->buf[0] = av_buffer_pool_get(client->frame_pool))
+        || av_image_fill_arrays(frame->data, frame->linesize, frame->buf[0]->data, format, width, height, 1) < 0) {
+        LOGW("allocating a pooled frame failed!\n");
+        av_frame_free(&frame);
+        return NULL;
     }
+    frame->format = format;
+    frame->width = width;
+    frame->height = height;
+    return frame;
+}
 
-    AVPacket *packet = av_packet_alloc();
-    if (!packet) {
-        LOGW("av_packet_alloc failed!\n");
-        return;
+/* takes over frame_decoded; returns it as is when it already has the requested format and size */
+static AVFrame *convert_rtsp_frame(RtspClient *client, AVFrame *frame_decoded) {
+    enum AVPixelFormat format = client->pixel_format == AV_PIX_FMT_NONE
+                                ? (enum AVPixelFormat) frame_decoded->format : client->pixel_format;
+    int width = client->width ? client->width : frame_decoded->width;
+    int height = client->height ? client->height : frame_decoded->height;
+    if (format == frame_decoded->format && width == frame_decoded->width && height == frame_decoded->height) {
+        return frame_decoded;
     }
-    if (av_new_packet(packet, client->codec_context->width * client->codec_context->height)) {
-        LOGW("av_new_packet failed!\n");
-        return;
+
+    AVFrame *frame_result = alloc_pooled_frame(client, format, width, height);
+    if (frame_result) {
+        if (convert_frame(client->converter, frame_decoded, frame_result) < 0) {
+            LOGW("convert_frame failed!\n");
+            av_frame_free(&frame_result);
+        } else {
+            av_frame_copy_props(frame_result, frame_decoded);
+        }
     }
+    av_frame_free(&frame_decoded);
+    return frame_result;
+}
 
-    while (av_read_frame(client->format_context, packet) >= 0) {
-        if (packet->stream_index == client->video_stream_index) {
-            if (avcodec_send_packet(client->codec_context, packet)) {
-                LOGW("avcodec_send_packet failed!\n");
-                goto end;
+/* the convert and deliver stage: decoded pictures in, frame_callback out; a slow callback only ever costs
+ * decoded pictures, never packets off the network */
+static void *convert_rtsp_frames(void *params) {
+    RtspClient *client = (RtspClient *) params;
+    double_t time_base = av_q2d(client->format_context->streams[client->video_stream_index]->time_base);
+    for (;;) {
+        AVFrame *frame_decoded = (AVFrame *) john_synchronized_queue_dequeue(client->frame_queue, STAGE_POLL_MILLIS);
+        if (!frame_decoded) {
+            if (atomic_load(&client->decode_ended) && john_synchronized_queue_is_empty(client->frame_queue)) {
+                break;
             }
+            continue;
+        }
 
-            double_t pts;
-
-            while (avcodec_receive_frame(client->codec_context, frame_decoded) >= 0) {
-                if ((pts = av_frame_get_best_effort_timestamp(frame_decoded)) == AV_NOPTS_VALUE) {
-                    pts = 0;
-                }
-                pts *= av_q2d(client->format_context->streams[client->video_stream_index]->time_base);
-
-                if (sws_scale(client->sws_context, (const uint8_t *const *)frame_decoded->data,
-                              frame_decoded->linesize, 0, client->codec_context->height,
-                              frame_result->data, frame_result->linesize) < 0) {
-                    LOGW("sws_scale failed!\n");
-                    goto end;
-                }
-
-                if (client->frame_callback) {
-                    client->frame_callback(frame_result->data, frame_result->linesize,
-                                           (uint32_t) client->codec_context->width,
-                                           (uint32_t) client->codec_context->height,
-                                           (int64_t) (pts * 1000));
-                }
-            }
+        double_t pts;
+        int64_t frame_pts = av_frame_get_best_effort_timestamp(frame_decoded);
+        if ((pts = frame_pts) == AV_NOPTS_VALUE) {
+            pts = 0;
+        }
+        pts *= time_base;
+
+        AVFrame *frame_result = convert_rtsp_frame(client, frame_decoded);
+        if (!frame_result) {
+            break;
+        }
+        if (client->latency_histogram) {
+            record_latency_stamps(client, frame_pts, frame_result->reordered_opaque, get_latency_clock_micros());
         }
-        av_packet_unref(packet);
+
+        if (client->av_frame_callback) {
+            /* the consumer's reference from here on */
+            client->av_frame_callback(frame_result, (int64_t) (pts * 1000), client->user_params);
+            continue;
+        }
+        if (client->frame_callback) {
+            client->frame_callback(frame_result->data, frame_result->linesize,
+                                   (uint32_t) frame_result->width, (uint32_t) frame_result->height,
+                                   (int64_t) (pts * 1000));
+        }
+        av_frame_free(&frame_result);
     }
+    atomic_store(&client->stopping, true);
+    return NULL;
+}
 
-    end:
-    av_free(buffer);
-    av_frame_free(&frame_decoded);
-    av_frame_free(&frame_result);
+/* the demux stage runs on the calling thread, the decode and convert stages on their own */
+void loop_read_rtsp_frame(RtspClient *client) {
+    LOGW("loop_read_rtsp_frame!\n");
+    if (!client) {
+        LOGW("client == NULL!\n");
+        return;
+    }
+
+    client->packet_queue = john_frame_queue_create(PACKET_QUEUE_CAPACITY, NULL, free_packet, NULL);
+    client->frame_queue = john_synchronized_queue_create(FRAME_QUEUE_CAPACITY, false, NULL);
+    if (!client->packet_queue || !client->frame_queue) {
+        LOGW("creating the stage queues failed!\n");
+        goto end;
+    }
+    atomic_store(&client->stopping, false);
+    atomic_store(&client->demux_ended, false);
+    atomic_store(&client->decode_ended, false);
+    client->dropped_frames = 0;
+
+    pthread_t decode_thread, convert_thread;
+    if (pthread_create(&decode_thread, NULL, decode_rtsp_packets, client)) {
+        LOGW("pthread_create failed!\n");
+        goto end;
+    }
+    if (pthread_create(&convert_thread, NULL, convert_rtsp_frames, client)) {
+        LOGW("pthread_create failed!\n");
+        atomic_store(&client->demux_ended, true);
+        pthread_join(decode_thread, NULL);
+        goto end;
+    }
+
+    AVPacket *packet = NULL;
+    while (!atomic_load(&client->stopping)) {
+        if (!packet && !(packet = av_packet_alloc())) {
+            LOGW("av_packet_alloc failed!\n");
+            break;
+        }
+        if (av_read_frame(client->format_context, packet) < 0) {
+            break;
+        }
+        if (packet->stream_index != client->video_stream_index) {
+            av_packet_unref(packet);
+            continue;
+        }
+        if (client->latency_histogram) {
+            keep_latency_stamps(client, packet, get_latency_clock_micros());
+        }
+        JohnFramePriority priority = (packet->flags & AV_PKT_FLAG_KEY)
+                                     ? JOHN_FRAME_KEY
+                                     : (JohnFramePriority) h264_frame_priority(packet->data, (uint32_t) packet->size);
+        /* the queue owns the packet from here on, even when it drops it */
+        john_frame_queue_enqueue(client->packet_queue, packet, (uint32_t) packet->size, priority);
+        packet = NULL;
+    }
     av_packet_free(&packet);
+    atomic_store(&client->demux_ended, true);
+    pthread_join(decode_thread, NULL);
+    pthread_join(convert_thread, NULL);
+
+    JohnFrameQueueStats stats;
+    john_frame_queue_get_stats(client->packet_queue, &stats);
+    LOGW("dropped %llu packets before decoding and %llu pictures before conversion\n",
+         (unsigned long long) stats.dropped_frames, (unsigned long long) client->dropped_frames);
+
+    end:
+    if (client->latency_histogram) {
+        print_latency_histogram(client->latency_histogram, stdout);
+    }
+    if (client->frame_queue) {
+        john_synchronized_queue_drain(client->frame_queue, free_frame, NULL);
+        john_synchronized_queue_destroy(client->frame_queue);
+        client->frame_queue = NULL;
+    }
+    if (client->packet_queue) {
+        john_frame_queue_destroy(client->packet_queue);
+        client->packet_queue = NULL;
+    }
 }
 
 void close_rtsp(RtspClient *client) {
     LOGW("close_rtsp!\n");
     if (client) {
-        sws_freeContext(client->sws_context);
+        destroy_latency_histogram(client->latency_histogram);
+        pthread_mutex_destroy(&client->latency_mutex);
+        destroy_frame_converter(client->converter);
+        av_buffer_pool_uninit(&client->frame_pool);
         avcodec_close(client->codec_context);
         avcodec_free_context(&client->codec_context);
         avformat_close_input(&client->format_context);
@@ -27,14 +27,26 @@ extern "C" {
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <libavutil/frame.h>
 #include <libavutil/pixfmt.h>
 
 typedef void (*FrameCallback)(uint8_t *data[8], int line_size[8],
                               uint32_t width, uint32_t height, int64_t pts_millis);
 
+/* frame is the consumer's own reference, it may be kept past the callback and is released with av_frame_free() */
+typedef void (*AVFrameCallback)(AVFrame *frame, int64_t pts_millis, void *user_params);
+
 typedef struct RtspClient RtspClient;
 
 RtspClient * open_rtsp(const char *rtsp_url, enum AVPixelFormat pixel_format, FrameCallback frame_callback);
+/** delivers refcounted frames instead of plane pointers into one reused buffer; pixel_format AV_PIX_FMT_NONE and
+ *  width/height 0 keep what the decoder outputs, and a frame that needs no conversion is delivered as decoded,
+ *  without any copy. Converted frames come from a buffer pool. **/
+RtspClient * open_rtsp_frames(const char *rtsp_url, enum AVPixelFormat pixel_format, int width, int height,
+                              AVFrameCallback frame_callback, void *user_params);
+/** prints the glass-to-glass latency per stage every report_every_frames frames (0: at the end only) and when
+ *  the loop ends; the stream has to come from hello_rtsp_server -l, see latency_probe.h **/
+void enable_rtsp_latency_report(RtspClient *client, uint32_t report_every_frames);
 void loop_read_rtsp_frame(RtspClient *client);
 void close_rtsp(RtspClient *client);
 
@@ -29,15 +29,95 @@ struct X264Stream {
     int width;
     int height;
     x264_picture_t *pic_in;
+    x264_picture_t pic_planes; /* wraps caller-owned planes, see append_i420_planes */
     x264_picture_t *pic_out;
     x264_t *h;
     x264_nal_t *nal;
     int i_nal;
     OnFrameEncodedFunc func;
+    OnPictureEncodedFunc picture_func;
+    void *user_client_params;
+    X264EncodedNal *encoded_nals;
+    int encoded_nals_capacity;
+    uint8_t *sps; /* without start code, copied from x264_encoder_headers */
+    uint32_t sps_size;
+    uint8_t *pps;
+    uint32_t pps_size;
+    int idr_requested; /* see request_x264_idr */
 };
 
-X264Stream *create_x264_module(int width, int height, const char *preset, const char *profile,
-                               OnFrameEncodedFunc func) {
+/* x264 reuses the payloads of x264_encoder_headers on the next encode, so the parameter sets are copied */
+static int copy_x264_parameter_sets(X264Stream *stream) {
+    x264_nal_t *nal;
+    int i_nal;
+    if (x264_encoder_headers(stream->h, &nal, &i_nal) < 0) {
+        return -1;
+    }
+    for (int i = 0; i < i_nal; ++i) {
+        uint8_t **copy;
+        uint32_t *copy_size;
+        if (nal[i].i_type == NAL_SPS) {
+            copy = &stream->sps;
+            copy_size = &stream->sps_size;
+        } else if (nal[i].i_type == NAL_PPS) {
+            copy = &stream->pps;
+            copy_size = &stream->pps_size;
+        } else {
+            continue;
+        }
+        int start_code_size = nal[i].b_long_startcode ? 4 : 3;
+        free(*copy);
+        *copy_size = (uint32_t) (nal[i].i_payload - start_code_size);
+        if (!(*copy = (uint8_t *) malloc(*copy_size))) {
+            *copy_size = 0;
+            return -1;
+        }
+        memcpy(*copy, nal[i].p_payload + start_code_size, *copy_size);
+    }
+    return stream->sps && stream->pps ? 0 : -1;
+}
+
+static int deliver_x264_picture(X264Stream *stream, int i_frame_size) {
+    if (stream->func) {
+        stream->func(stream->nal->p_payload, (uint32_t) i_frame_size);
+    }
+    if (stream->picture_func) {
+        if (stream->i_nal > stream->encoded_nals_capacity) {
+            X264EncodedNal *nals = (X264EncodedNal *) realloc(stream->encoded_nals,
+                                                              sizeof(X264EncodedNal) * stream->i_nal);
+            if (!nals) {
+                LOGW("realloc X264EncodedNal failed!\n");
+                return -1;
+            }
+            stream->encoded_nals = nals;
+            stream->encoded_nals_capacity = stream->i_nal;
+        }
+        for (int i = 0; i < stream->i_nal; ++i) {
+            X264EncodedNal *nal = &stream->encoded_nals[i];
+            nal->payload = stream->nal[i].p_payload;
+            nal->size = (uint32_t) stream->nal[i].i_payload;
+            nal->start_code_size = stream->nal[i].b_long_startcode ? 4 : 3;
+            nal->type = stream->nal[i].i_type;
+            nal->ref_idc = stream->nal[i].i_ref_idc;
+        }
+        X264EncodedPicture picture;
+        picture.nals = stream->encoded_nals;
+        picture.nal_count = stream->i_nal;
+        picture.size = (uint32_t) i_frame_size;
+        picture.pts = stream->pic_out->i_pts;
+        picture.dts = stream->pic_out->i_dts;
+        picture.keyframe = stream->pic_out->b_keyframe;
+        picture.idr = 0;
+        for (int i = 0; i < stream->i_nal; ++i) {
+            picture.idr |= stream->nal[i].i_type == NAL_SLICE_IDR;
+        }
+        stream->picture_func(&picture, stream->user_client_params);
+    }
+    return 0;
+}
+
+/* takes the fully configured param, common to every create_x264_*_module */
+static X264Stream *open_x264_module(x264_param_t *param, OnFrameEncodedFunc func) {
     X264Stream *stream = (X264Stream *) malloc(sizeof(X264Stream));
     if (!stream) {
         LOGW("malloc X264Stream failed!\n");
@@ -45,7 +125,45 @@ X264Stream *create_x264_module(int width, int height, const char *preset, const
     }
     memset(stream, 0, sizeof(X264Stream));
     stream->func = func;
+    stream->width = param->i_width;
+    stream->height = param->i_height;
 
+    stream->pic_in = (x264_picture_t *) malloc(sizeof(x264_picture_t));
+    if (!stream->pic_in) {
+        LOGW("malloc x264_picture_t[pic_in] failed!\n");
+        return NULL;
+    }
+    if (x264_picture_alloc(stream->pic_in, param->i_csp, param->i_width, param->i_height) < 0) {
+        LOGW("x264_picture_alloc failed!\n");
+        return NULL;
+    }
+
+    x264_picture_init(&stream->pic_planes);
+    stream->pic_planes.img.i_csp = param->i_csp;
+    stream->pic_planes.img.i_plane = 3;
+
+    stream->pic_out = (x264_picture_t *) malloc(sizeof(x264_picture_t));
+    if (!stream->pic_out) {
+        LOGW("malloc x264_picture_t[pic_out] failed!\n");
+        return NULL;
+    }
+
+    stream->h = x264_encoder_open(param);
+    if (!stream->h) {
+        LOGW("x264_encoder_open failed!\n");
+        x264_picture_clean(stream->pic_in);
+        return NULL;
+    }
+
+    if (copy_x264_parameter_sets(stream) < 0) {
+        LOGW("x264_encoder_headers failed!\n");
+    }
+
+    return stream;
+}
+
+X264Stream *create_x264_module(int width, int height, const char *preset, const char *profile,
+                               OnFrameEncodedFunc func) {
     x264_param_t param;
     /* Get default params for preset/tuning */
     if (x264_param_default_preset(&param, (preset ? preset : "medium"), NULL) < 0) {
@@ -55,8 +173,8 @@ X264Stream *create_x264_module(int width, int height, const char *preset, const
 
     /* Configure non-default params */
     param.i_csp = X264_CSP_I420;
-    param.i_width = stream->width = width;
-    param.i_height = stream->height = height;
+    param.i_width = width;
+    param.i_height = height;
     param.b_vfr_input = 0;
     param.b_repeat_headers = 1;
     param.b_annexb = 1;
@@ -67,30 +185,102 @@ X264Stream *create_x264_module(int width, int height, const char *preset, const
         return NULL;
     }
 
-    stream->pic_in = (x264_picture_t *) malloc(sizeof(x264_picture_t));
-    if (!stream->pic_in) {
-        LOGW("malloc x264_picture_t[pic_in] failed!\n");
+    return open_x264_module(&param, func);
+}
+
+void x264_live_config_default(X264LiveConfig *config) {
+    memset(config, 0, sizeof(X264LiveConfig));
+    config->preset = "veryfast";
+    config->profile = "main";
+    config->fps_num = 25;
+    config->fps_den = 1;
+    config->keyint = 50;
+    config->intra_refresh = 1;
+    config->bitrate_kbps = 800;
+    config->slice_max_size = 1400; /* a 1500 byte MTU less IP, UDP and RTP headers */
+}
+
+X264Stream *create_x264_live_module(int width, int height, const X264LiveConfig *config, OnFrameEncodedFunc func) {
+    x264_param_t param;
+    /* zerolatency drops B frames, lookahead, mbtree and frame threads, and turns sliced threads on */
+    if (x264_param_default_preset(&param, (config->preset ? config->preset : "veryfast"), "zerolatency") < 0) {
+        LOGW("x264_param_default_preset failed!\n");
         return NULL;
     }
-    if (x264_picture_alloc(stream->pic_in, param.i_csp, param.i_width, param.i_height) < 0) {
-        LOGW("x264_picture_alloc failed!\n");
-        return NULL;
+
+    param.i_csp = X264_CSP_I420;
+    param.i_width = width;
+    param.i_height = height;
+    param.b_vfr_input = 0;
+    param.b_repeat_headers = 1;
+    param.b_annexb = 1;
+    param.i_fps_num = (uint32_t) (config->fps_num > 0 ? config->fps_num : 25);
+    param.i_fps_den = (uint32_t) (config->fps_den > 0 ? config->fps_den : 1);
+    param.i_threads = config->threads;
+    param.b_sliced_threads = 1;
+    param.i_slice_max_size = config->slice_max_size;
+    if (config->keyint > 0) {
+        param.i_keyint_max = config->keyint;
     }
+    param.b_intra_refresh = config->intra_refresh ? 1 : 0;
 
-    stream->pic_out = (x264_picture_t *) malloc(sizeof(x264_picture_t));
-    if (!stream->pic_out) {
-        LOGW("malloc x264_picture_t[pic_out] failed!\n");
-        return NULL;
+    /* VBV keeps every frame close to the average size, so none of them waits on the link */
+    int vbv_buffer_kbit = config->vbv_buffer_kbit > 0 ? config->vbv_buffer_kbit
+                          : (int) ((int64_t) config->bitrate_kbps * param.i_fps_den / param.i_fps_num);
+    if (config->crf > 0) {
+        param.rc.i_rc_method = X264_RC_CRF;
+        param.rc.f_rf_constant = config->crf;
+    } else {
+        param.rc.i_rc_method = X264_RC_ABR;
+        param.rc.i_bitrate = config->bitrate_kbps; /* ABR with vbv_max_bitrate == bitrate is CBR */
+    }
+    if (config->bitrate_kbps > 0) {
+        param.rc.i_vbv_max_bitrate = config->bitrate_kbps;
+        param.rc.i_vbv_buffer_size = vbv_buffer_kbit > 0 ? vbv_buffer_kbit : 1;
     }
 
-    stream->h = x264_encoder_open(&param);
-    if (!stream->h) {
-        LOGW("x264_encoder_open failed!\n");
-        x264_picture_clean(stream->pic_in);
+    if (x264_param_apply_profile(&param, (config->profile ? config->profile : "main")) < 0) {
+        LOGW("x264_param_apply_profile failed!\n");
         return NULL;
     }
 
-    return stream;
+    return open_x264_module(&param, func);
+}
+
+int reconfigure_x264_bitrate(X264Stream *stream, int bitrate_kbps, int vbv_buffer_kbit) {
+    if (bitrate_kbps <= 0) {
+        return -1;
+    }
+    x264_param_t param;
+    x264_encoder_parameters(stream->h, &param);
+    if (vbv_buffer_kbit <= 0) {
+        vbv_buffer_kbit = (int) ((int64_t) bitrate_kbps * param.i_fps_den / (param.i_fps_num ? param.i_fps_num : 25));
+    }
+    if (param.rc.i_rc_method == X264_RC_ABR) {
+        param.rc.i_bitrate = bitrate_kbps;
+    }
+    param.rc.i_vbv_max_bitrate = bitrate_kbps;
+    param.rc.i_vbv_buffer_size = vbv_buffer_kbit > 0 ? vbv_buffer_kbit : 1;
+    if (x264_encoder_reconfig(stream->h, &param) < 0) {
+        LOGW("x264_encoder_reconfig failed!\n");
+        return -1;
+    }
+    return 0;
+}
+
+void set_x264_picture_callback(X264Stream *stream, OnPictureEncodedFunc func, void *user_client_params) {
+    stream->picture_func = func;
+    stream->user_client_params = user_client_params;
+}
+
+/* x264 keeps the type of a picture as given, so it goes back to automatic after the requested IDR */
+static void take_x264_idr_request(X264Stream *stream, x264_picture_t *picture) {
+    picture->i_type = stream->idr_requested ? X264_TYPE_IDR : X264_TYPE_AUTO;
+    stream->idr_requested = 0;
+}
+
+void request_x264_idr(X264Stream *stream) {
+    stream->idr_requested = 1;
 }
 
 int append_i420_frame(X264Stream *stream, uint8_t *frame_data) {
@@ -101,13 +291,34 @@ int append_i420_frame(X264Stream *stream, uint8_t *frame_data) {
     memcpy(stream->pic_in->img.plane[2], frame_data + luma_size + chroma_size, chroma_size);
 
     ++stream->pic_in->i_pts;
+    take_x264_idr_request(stream, stream->pic_in);
 
     int i_frame_size;
     i_frame_size = x264_encoder_encode(stream->h, &stream->nal, &stream->i_nal, stream->pic_in, stream->pic_out);
     if (i_frame_size < 0) {
         return -1;
     } else if (i_frame_size) {
-        stream->func(stream->nal->p_payload, (uint32_t) i_frame_size);
+        return deliver_x264_picture(stream, i_frame_size);
+    }
+
+    return 0;
+}
+
+int append_i420_planes(X264Stream *stream, uint8_t *planes[3], int strides[3], int64_t pts) {
+    for (int i = 0; i < 3; ++i) {
+        stream->pic_planes.img.plane[i] = planes[i];
+        stream->pic_planes.img.i_stride[i] = strides[i];
+    }
+    /* append_i420_frame keeps counting from the last pts either way */
+    stream->pic_in->i_pts = stream->pic_planes.i_pts = pts < 0 ? stream->pic_in->i_pts + 1 : pts;
+    take_x264_idr_request(stream, &stream->pic_planes);
+
+    int i_frame_size;
+    i_frame_size = x264_encoder_encode(stream->h, &stream->nal, &stream->i_nal, &stream->pic_planes, stream->pic_out);
+    if (i_frame_size < 0) {
+        return -1;
+    } else if (i_frame_size) {
+        return deliver_x264_picture(stream, i_frame_size);
     }
 
     return 0;
@@ -119,13 +330,25 @@ int encode_x264_frame(X264Stream *stream) {
         i_frame_size = x264_encoder_encode(stream->h, &stream->nal, &stream->i_nal, NULL, stream->pic_out);
         if (i_frame_size < 0) {
             return -1;
-        } else if (i_frame_size) {
-            stream->func(stream->nal->p_payload, (uint32_t) i_frame_size);
+        } else if (i_frame_size && deliver_x264_picture(stream, i_frame_size) < 0) {
+            return -1;
         }
     }
     return 0;
 }
 
+int get_x264_parameter_sets(X264Stream *stream, const uint8_t **sps, uint32_t *sps_size,
+                            const uint8_t **pps, uint32_t *pps_size) {
+    if (!stream->sps || !stream->pps) {
+        return -1;
+    }
+    *sps = stream->sps;
+    *sps_size = stream->sps_size;
+    *pps = stream->pps;
+    *pps_size = stream->pps_size;
+    return 0;
+}
+
 void destroy_x264_module(X264Stream *stream) {
     if (stream) {
         if (stream->h) {
@@ -141,6 +364,10 @@ void destroy_x264_module(X264Stream *stream) {
             free(stream->pic_out);
             stream->pic_out = NULL;
         }
+        free(stream->encoded_nals);
+        stream->encoded_nals = NULL;
+        free(stream->sps);
+        free(stream->pps);
         free(stream);
     }
 }
@@ -29,13 +29,69 @@ extern "C" {
 
 typedef void (*OnFrameEncodedFunc)(uint8_t *payload, uint32_t size);
 
+typedef struct X264EncodedNal {
+    uint8_t *payload;         /* Annex-B, starting with its start code */
+    uint32_t size;            /* including the start code */
+    uint32_t start_code_size; /* 3 or 4 */
+    int type;                 /* nal_unit_type, see h264_nal.h */
+    int ref_idc;
+} X264EncodedNal;
+
+/** the NAL units are contiguous, nals[0].payload holds the whole picture; valid during the callback only **/
+typedef struct X264EncodedPicture {
+    X264EncodedNal *nals;
+    int nal_count;
+    uint32_t size; /* sum of the NAL unit sizes */
+    int64_t pts;   /* as passed in, in frames */
+    int64_t dts;
+    int keyframe;  /* with intra_refresh also the recovery point pictures, which need the frames before them */
+    int idr;       /* holds an IDR slice, decodable on its own */
+} X264EncodedPicture;
+
+typedef void (*OnPictureEncodedFunc)(const X264EncodedPicture *picture, void *user_client_params);
+
 typedef struct X264Stream X264Stream;
 
+/** low-latency live encoding: zerolatency tuning (no B frames, no lookahead, no frame threads), so every
+ *  picture comes out of the encoder call that took it in **/
+typedef struct X264LiveConfig {
+    const char *preset;      /* "ultrafast" ... "medium" */
+    const char *profile;     /* "baseline", "main", "high" */
+    int fps_num;
+    int fps_den;
+    int threads;             /* sliced threads, 0 lets x264 decide */
+    int keyint;              /* frames per GOP, or per intra refresh wave */
+    int intra_refresh;       /* spread the intra blocks over keyint frames instead of sending IDR spikes */
+    int bitrate_kbps;        /* CBR target, or the VBV cap when crf > 0 */
+    float crf;               /* > 0 selects VBV capped CRF instead of CBR */
+    int vbv_buffer_kbit;     /* 0 means one frame's worth of bitrate_kbps */
+    int slice_max_size;      /* bytes per slice, 0 for one slice per picture; match the RTP payload (MTU - 40) */
+} X264LiveConfig;
+
+void x264_live_config_default(X264LiveConfig *config);
+X264Stream *create_x264_live_module(int width, int height, const X264LiveConfig *config, OnFrameEncodedFunc func);
+
+/** moves the rate control of a running encoder to bitrate_kbps (the CBR target, or the VBV cap of capped CRF),
+ *  vbv_buffer_kbit 0 means one frame's worth; to be called on the encoding thread, between two frames **/
+int reconfigure_x264_bitrate(X264Stream *stream, int bitrate_kbps, int vbv_buffer_kbit);
+
 /** preset = { "faster", "fast", "medium", "slow", "slower" }; profile = { "high", "main", "baseline" }; **/
 X264Stream *create_x264_module(int width, int height, const char *preset, const char *profile,
                                OnFrameEncodedFunc func);
+/** func may be NULL when the stream reports through set_x264_picture_callback only **/
+void set_x264_picture_callback(X264Stream *stream, OnPictureEncodedFunc func, void *user_client_params);
 int append_i420_frame(X264Stream *stream, uint8_t *frame_data);
+/** encodes caller-owned planes in place (x264 takes its own copy while encoding), they need to stay valid
+ *  during the call only; pts < 0 continues the frame counter of append_i420_frame **/
+int append_i420_planes(X264Stream *stream, uint8_t *planes[3], int strides[3], int64_t pts);
 int encode_x264_frame(X264Stream *stream);
+/** the next picture appended is encoded as an IDR, with intra_refresh too (where no other picture after the first
+ *  is one); to be called on the encoding thread, between two frames **/
+void request_x264_idr(X264Stream *stream);
+/** the SPS and PPS without start codes (x264_encoder_headers), known as soon as the stream is created,
+ *  so the SDP can be answered before the first frame; valid until destroy_x264_module **/
+int get_x264_parameter_sets(X264Stream *stream, const uint8_t **sps, uint32_t *sps_size,
+                            const uint8_t **pps, uint32_t *pps_size);
 void destroy_x264_module(X264Stream *stream);
 
 #ifdef __cplusplus
@@ -0,0 +1,351 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * Frame-in to NAL-out latency of X264Stream per encoder setting.
+ * Frames of a raw I420 clip are fed at the clip's frame rate like a camera would (or as fast as possible
+ * with -r 0), the latency of a picture is the time from handing its frame to the encoder until its
+ * NAL units come out, including the frames the encoder held back.
+ * Reported per setting: p50/p99/max latency, frames still held back when the input ended,
+ * and the average and biggest picture and slice sizes (IDR spikes the network has to absorb).
+ *
+ * usage: x264_latency_bench [-i yuv_file] [-s widthxheight] [-n max_frames] [-r fps]
+ *                           [-k bitrate_kbps] [-m slice_max_size] [-b name_filter] [-f table|csv|json]
+ *   the clip is made by: ffmpeg -i data/cuc_ieschool.mp4 -c:v rawvideo -pix_fmt yuv420p data/cuc_ieschool.yuv
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "../rtsp/x264_stream.h"
+
+typedef struct BenchOptions {
+    const char *yuv_file;
+    int width;
+    int height;
+    uint32_t max_frames;
+    int fps;
+    int bitrate_kbps;
+    int slice_max_size;
+    const char *filter;
+    const char *format;
+} BenchOptions;
+
+typedef struct BenchSetting {
+    const char *name;
+    bool live; /* false: create_x264_module with its defaults */
+    const char *preset;
+    float crf;
+    int intra_refresh;
+    bool single_slice;
+} BenchSetting;
+
+typedef struct BenchResult {
+    const char *name;
+    uint32_t frames_in;
+    uint32_t pictures_out;
+    uint32_t held_back; /* pictures still inside the encoder when the input ended */
+    uint64_t *input_nanos; /* indexed by pts */
+    uint64_t *latency_nanos;
+    uint64_t total_bytes;
+    uint32_t max_picture_bytes;
+    uint32_t max_nal_bytes;
+    double seconds;
+} BenchResult;
+
+static const BenchSetting bench_settings[] = {
+    { "medium",          false, NULL,        0,  0, false },
+    { "live-cbr",        true,  "veryfast",  0,  1, false },
+    { "live-crf",        true,  "veryfast",  23, 1, false },
+    { "live-idr",        true,  "veryfast",  0,  0, false },
+    { "live-one-slice",  true,  "veryfast",  0,  1, true  },
+    { "live-ultrafast",  true,  "ultrafast", 0,  1, false },
+};
+
+static inline uint64_t now_nanos() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+static void sleep_until(uint64_t deadline_nanos) {
+    uint64_t now = now_nanos();
+    if (deadline_nanos > now) {
+        struct timespec duration;
+        duration.tv_sec = (time_t) ((deadline_nanos - now) / 1000000000ULL);
+        duration.tv_nsec = (long) ((deadline_nanos - now) % 1000000000ULL);
+        nanosleep(&duration, NULL);
+    }
+}
+
+static void on_picture_encoded(const X264EncodedPicture *picture, void *user_client_params) {
+    uint64_t now = now_nanos();
+    BenchResult *result = (BenchResult *) user_client_params;
+    if (picture->pts >= 0 && (uint64_t) picture->pts < result->frames_in) {
+        result->latency_nanos[result->pictures_out++] = now - result->input_nanos[picture->pts];
+    }
+    result->total_bytes += picture->size;
+    if (picture->size > result->max_picture_bytes) {
+        result->max_picture_bytes = picture->size;
+    }
+    for (int i = 0; i < picture->nal_count; ++i) {
+        if (picture->nals[i].size > result->max_nal_bytes) {
+            result->max_nal_bytes = picture->nals[i].size;
+        }
+    }
+}
+
+static X264Stream *open_setting(const BenchSetting *setting, const BenchOptions *options) {
+    if (!setting->live) {
+        return create_x264_module(options->width, options->height, setting->preset, NULL, NULL);
+    }
+    X264LiveConfig config;
+    x264_live_config_default(&config);
+    config.preset = setting->preset;
+    if (options->fps > 0) {
+        config.fps_num = options->fps;
+    }
+    config.crf = setting->crf;
+    config.intra_refresh = setting->intra_refresh;
+    config.bitrate_kbps = options->bitrate_kbps;
+    config.slice_max_size = setting->single_slice ? 0 : options->slice_max_size;
+    return create_x264_live_module(options->width, options->height, &config, NULL);
+}
+
+static bool run_setting(const BenchSetting *setting, const BenchOptions *options, uint8_t *frames,
+                        uint32_t frame_count, BenchResult *result) {
+    X264Stream *stream = open_setting(setting, options);
+    if (!stream) {
+        fprintf(stderr, "%s: opening the encoder failed\n", setting->name);
+        return false;
+    }
+    set_x264_picture_callback(stream, on_picture_encoded, result);
+
+    size_t luma_size = (size_t) options->width * options->height;
+    size_t frame_size = luma_size * 3 / 2;
+    int strides[3] = { options->width, options->width / 2, options->width / 2 };
+    uint64_t interval = options->fps > 0 ? 1000000000ULL / (uint64_t) options->fps : 0;
+    uint64_t start = now_nanos();
+    bool ok = true;
+    for (uint32_t i = 0; i < frame_count; ++i) {
+        if (interval) {
+            sleep_until(start + i * interval);
+        }
+        uint8_t *frame = frames + frame_size * i;
+        uint8_t *planes[3] = { frame, frame + luma_size, frame + luma_size + luma_size / 4 };
+        result->input_nanos[i] = now_nanos();
+        result->frames_in = i + 1;
+        if (append_i420_planes(stream, planes, strides, i) < 0) {
+            fprintf(stderr, "%s: append_i420_planes failed\n", setting->name);
+            ok = false;
+            break;
+        }
+    }
+    result->held_back = result->frames_in - result->pictures_out;
+    if (ok && encode_x264_frame(stream) < 0) {
+        fprintf(stderr, "%s: encode_x264_frame failed\n", setting->name);
+        ok = false;
+    }
+    result->seconds = (double) (now_nanos() - start) / 1e9;
+    destroy_x264_module(stream);
+    return ok;
+}
+
+static int compare_nanos(const void *left, const void *right) {
+    uint64_t a = *(const uint64_t *) left, b = *(const uint64_t *) right;
+    return a < b ? -1 : a > b;
+}
+
+static double percentile_millis(const BenchResult *result, double quantile) {
+    if (result->pictures_out == 0) {
+        return 0;
+    }
+    uint32_t rank = (uint32_t) (quantile * (double) (result->pictures_out - 1));
+    return (double) result->latency_nanos[rank] / 1e6;
+}
+
+/************************* output *************************/
+
+static void print_header(const BenchOptions *options) {
+    if (strcmp(options->format, "csv") == 0) {
+        printf("name,width,height,fps,frames,pictures,held_back,seconds,p50_ms,p99_ms,max_ms,"
+               "avg_picture_bytes,max_picture_bytes,max_nal_bytes\n");
+    } else if (strcmp(options->format, "json") == 0) {
+        printf("[");
+    } else {
+        printf("%-18s %7s %9s %9s %9s %10s %12s %12s %10s\n",
+               "name", "frames", "p50(ms)", "p99(ms)", "max(ms)", "held-back", "avg-picture", "max-picture",
+               "max-nal");
+    }
+}
+
+static void print_result(const BenchOptions *options, const BenchResult *result, bool first) {
+    double p50 = percentile_millis(result, 0.5);
+    double p99 = percentile_millis(result, 0.99);
+    double max = percentile_millis(result, 1.0);
+    uint64_t average = result->frames_in ? result->total_bytes / result->frames_in : 0;
+    if (strcmp(options->format, "csv") == 0) {
+        printf("%s,%d,%d,%d,%u,%u,%u,%.3f,%.3f,%.3f,%.3f,%llu,%u,%u\n",
+               result->name, options->width, options->height, options->fps, result->frames_in,
+               result->pictures_out, result->held_back, result->seconds, p50, p99, max,
+               (unsigned long long) average, result->max_picture_bytes, result->max_nal_bytes);
+    } else if (strcmp(options->format, "json") == 0) {
+        printf("%s\n  {\"name\": \"%s\", \"width\": %d, \"height\": %d, \"fps\": %d, \"frames\": %u, "
+               "\"pictures\": %u, \"held_back\": %u, \"seconds\": %.3f, \"p50_ms\": %.3f, \"p99_ms\": %.3f, "
+               "\"max_ms\": %.3f, \"avg_picture_bytes\": %llu, \"max_picture_bytes\": %u, \"max_nal_bytes\": %u}",
+               first ? "" : ",", result->name, options->width, options->height, options->fps, result->frames_in,
+               result->pictures_out, result->held_back, result->seconds, p50, p99, max,
+               (unsigned long long) average, result->max_picture_bytes, result->max_nal_bytes);
+    } else {
+        printf("%-18s %7u %9.2f %9.2f %9.2f %10u %12llu %12u %10u\n", result->name, result->frames_in,
+               p50, p99, max, result->held_back, (unsigned long long) average, result->max_picture_bytes,
+               result->max_nal_bytes);
+    }
+    fflush(stdout);
+}
+
+static void print_footer(const BenchOptions *options) {
+    if (strcmp(options->format, "json") == 0) {
+        printf("\n]\n");
+    }
+}
+
+static bool matches_filter(const char *filter, const char *name) {
+    if (!filter) {
+        return true;
+    }
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "%s", filter);
+    for (char *save = NULL, *token = strtok_r(buffer, ",", &save); token; token = strtok_r(NULL, ",", &save)) {
+        if (strstr(name, token)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* the whole clip is read up front, so disk reads do not show up as latency */
+static uint8_t *load_frames(const BenchOptions *options, uint32_t *frame_count) {
+    size_t frame_size = (size_t) options->width * options->height * 3 / 2;
+    FILE *file = fopen(options->yuv_file, "rb");
+    if (!file) {
+        return NULL;
+    }
+    uint8_t *frames = NULL;
+    uint32_t count = 0, capacity = 0;
+    while (count < options->max_frames) {
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            uint8_t *grown = (uint8_t *) realloc(frames, frame_size * capacity);
+            if (!grown) {
+                break;
+            }
+            frames = grown;
+        }
+        if (fread(frames + frame_size * count, 1, frame_size, file) != frame_size) {
+            break;
+        }
+        ++count;
+    }
+    fclose(file);
+    *frame_count = count;
+    return frames;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "usage: %s [-i yuv_file] [-s widthxheight] [-n max_frames] [-r fps] [-k bitrate_kbps] "
+                    "[-m slice_max_size] [-b name_filter] [-f table|csv|json]\n", program);
+}
+
+int main(int argc, char **argv) {
+    BenchOptions options = { "data/cuc_ieschool.yuv", 512, 288, 1000, 25, 800, 1400, NULL, "table" };
+    int option;
+    while ((option = getopt(argc, argv, "i:s:n:r:k:m:b:f:h")) != -1) {
+        switch (option) {
+            case 'i':
+                options.yuv_file = optarg;
+                break;
+            case 's':
+                if (sscanf(optarg, "%dx%d", &options.width, &options.height) != 2) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'n':
+                options.max_frames = (uint32_t) strtoul(optarg, NULL, 10);
+                break;
+            case 'r':
+                options.fps = atoi(optarg);
+                break;
+            case 'k':
+                options.bitrate_kbps = atoi(optarg);
+                break;
+            case 'm':
+                options.slice_max_size = atoi(optarg);
+                break;
+            case 'b':
+                options.filter = optarg;
+                break;
+            case 'f':
+                options.format = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (options.width <= 0 || options.height <= 0 || options.width % 2 || options.height % 2 || options.fps < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    uint32_t frame_count = 0;
+    uint8_t *frames = load_frames(&options, &frame_count);
+    if (!frames || frame_count == 0) {
+        fprintf(stderr, "reading %s failed, see the usage comment in %s\n", options.yuv_file, __FILE__);
+        free(frames);
+        return 1;
+    }
+
+    bool first = true;
+    print_header(&options);
+    for (size_t s = 0; s < sizeof(bench_settings) / sizeof(bench_settings[0]); ++s) {
+        if (!matches_filter(options.filter, bench_settings[s].name)) {
+            continue;
+        }
+        BenchResult result;
+        memset(&result, 0, sizeof(result));
+        result.name = bench_settings[s].name;
+        result.input_nanos = (uint64_t *) calloc(frame_count, sizeof(uint64_t));
+        result.latency_nanos = (uint64_t *) calloc(frame_count, sizeof(uint64_t));
+        if (result.input_nanos && result.latency_nanos
+            && run_setting(&bench_settings[s], &options, frames, frame_count, &result)) {
+            qsort(result.latency_nanos, result.pictures_out, sizeof(uint64_t), compare_nanos);
+            print_result(&options, &result, first);
+            first = false;
+        }
+        free(result.input_nanos);
+        free(result.latency_nanos);
+    }
+    print_footer(&options);
+    free(frames);
+    return 0;
+}
@@ -0,0 +1,342 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements. See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache license, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License. You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the license for the specific language governing permissions and
+ * limitations under the license.
+ */
+/**
+ * How many live streams one host encodes at the target frame rate.
+ * Ramps the number of streams, each one an X264Stream with the live profile and one encoder thread,
+ * all paced by one EncodeScheduler on one worker per cpu, the way hello_rtsp_server runs its streams.
+ * A step passes when at least 98% of the ticks of every stream got encoded in time (see
+ * EncodeStreamStats.late_frames); the ramp stops at the first failing step.
+ * Reported per step: achieved fps per stream, on-time ratio, average and worst encode time.
+ *
+ * usage: x264_load_bench [-i yuv_file] [-s widthxheight] [-n max_frames] [-r fps] [-k bitrate_kbps]
+ *                        [-p preset] [-t seconds_per_step] [-m max_streams] [-w workers] [-f table|csv|json]
+ *   the clip is made by: ffmpeg -i data/cuc_ieschool.mp4 -c:v rawvideo -pix_fmt yuv420p data/cuc_ieschool.yuv
+ * @author John Kenrinus Lee
+ * @version 2026-10-16
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "../rtsp/x264_stream.h"
+#include "../rtsp/encode_scheduler.h"
+
+#define ON_TIME_TARGET 0.98
+
+typedef struct BenchOptions {
+    const char *yuv_file;
+    int width;
+    int height;
+    uint32_t max_frames;
+    int fps;
+    int bitrate_kbps;
+    const char *preset;
+    int seconds;
+    uint32_t max_streams;
+    uint32_t workers;
+    const char *format;
+} BenchOptions;
+
+typedef struct BenchStream {
+    X264Stream *stream;
+    const BenchOptions *options;
+    const uint8_t *frames;
+    uint32_t frame_count;
+    uint32_t next_frame;
+    int stream_id;
+    bool failed;
+} BenchStream;
+
+typedef struct BenchResult {
+    uint32_t streams;
+    uint64_t encoded_frames;
+    uint64_t late_frames;
+    double worst_on_time; /* of the stream with the most late frames */
+    uint64_t total_encode_nanos;
+    uint64_t max_encode_nanos;
+    double seconds;
+    bool passed;
+} BenchResult;
+
+static inline uint64_t now_nanos() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+/* on a scheduler worker; the streams start at different frames of the clip so they do not encode in lockstep */
+static bool encode_bench_frame(void *stream_params, uint64_t tick) {
+    BenchStream *bench = (BenchStream *) stream_params;
+    size_t luma_size = (size_t) bench->options->width * bench->options->height;
+    uint8_t *frame = (uint8_t *) bench->frames + luma_size * 3 / 2 * (bench->next_frame++ % bench->frame_count);
+    uint8_t *planes[3] = { frame, frame + luma_size, frame + luma_size + luma_size / 4 };
+    int strides[3] = { bench->options->width, bench->options->width / 2, bench->options->width / 2 };
+    if (append_i420_planes(bench->stream, planes, strides, (int64_t) tick) < 0) {
+        bench->failed = true;
+        return false;
+    }
+    return true;
+}
+
+static X264Stream *open_stream(const BenchOptions *options) {
+    X264LiveConfig config;
+    x264_live_config_default(&config);
+    config.preset = options->preset;
+    config.fps_num = options->fps;
+    config.threads = 1;
+    config.bitrate_kbps = options->bitrate_kbps;
+    return create_x264_live_module(options->width, options->height, &config, NULL);
+}
+
+static bool run_step(const BenchOptions *options, const uint8_t *frames, uint32_t frame_count, uint32_t stream_count,
+                     BenchResult *result) {
+    BenchStream *streams = (BenchStream *) calloc(stream_count, sizeof(BenchStream));
+    EncodeScheduler *scheduler = create_encode_scheduler(options->workers, options->fps, 1);
+    bool ok = streams && scheduler;
+    /* open every encoder first, so the encoder setup does not count against the first streams */
+    for (uint32_t i = 0; ok && i < stream_count; ++i) {
+        streams[i].options = options;
+        streams[i].frames = frames;
+        streams[i].frame_count = frame_count;
+        streams[i].next_frame = i * frame_count / stream_count;
+        streams[i].stream_id = -1;
+        if (!(streams[i].stream = open_stream(options))) {
+            fprintf(stderr, "%u streams: create_x264_live_module failed\n", stream_count);
+            ok = false;
+        }
+    }
+    uint64_t start = now_nanos();
+    for (uint32_t i = 0; ok && i < stream_count; ++i) {
+        if ((streams[i].stream_id = add_encode_stream(scheduler, encode_bench_frame, &streams[i])) < 0) {
+            ok = false;
+        }
+    }
+    if (ok) {
+        sleep((unsigned int) options->seconds);
+    }
+    result->seconds = (double) (now_nanos() - start) / 1e9;
+    result->streams = stream_count;
+    result->worst_on_time = 1;
+    for (uint32_t i = 0; streams && i < stream_count; ++i) {
+        EncodeStreamStats stats;
+        if (scheduler && get_encode_stream_stats(scheduler, streams[i].stream_id, &stats)) {
+            result->encoded_frames += stats.encoded_frames;
+            result->late_frames += stats.late_frames;
+            result->total_encode_nanos += stats.total_encode_nanos;
+            if (stats.max_encode_nanos > result->max_encode_nanos) {
+                result->max_encode_nanos = stats.max_encode_nanos;
+            }
+            uint64_t ticks = stats.encoded_frames + stats.late_frames;
+            double on_time = ticks ? (double) stats.encoded_frames / (double) ticks : 0;
+            if (on_time < result->worst_on_time) {
+                result->worst_on_time = on_time;
+            }
+            remove_encode_stream(scheduler, streams[i].stream_id);
+        }
+        if (streams[i].failed) {
+            fprintf(stderr, "%u streams: append_i420_planes failed\n", stream_count);
+            ok = false;
+        }
+        destroy_x264_module(streams[i].stream);
+    }
+    destroy_encode_scheduler(scheduler);
+    free(streams);
+    result->passed = ok && result->worst_on_time >= ON_TIME_TARGET;
+    return ok;
+}
+
+/************************* output *************************/
+
+static double achieved_fps(const BenchResult *result) {
+    return result->streams && result->seconds > 0
+           ? (double) result->encoded_frames / result->streams / result->seconds : 0;
+}
+
+static double average_encode_millis(const BenchResult *result) {
+    return result->encoded_frames ? (double) result->total_encode_nanos / (double) result->encoded_frames / 1e6 : 0;
+}
+
+static void print_header(const BenchOptions *options, uint32_t workers) {
+    if (strcmp(options->format, "csv") == 0) {
+        printf("streams,width,height,target_fps,workers,seconds,encoded,late,fps_per_stream,worst_on_time,"
+               "avg_encode_ms,max_encode_ms,passed\n");
+    } else if (strcmp(options->format, "json") == 0) {
+        printf("[");
+    } else {
+        printf("%dx%d at %d fps, preset %s, %u workers\n", options->width, options->height, options->fps,
+               options->preset, workers);
+        printf("%8s %10s %8s %12s %14s %12s %12s %7s\n",
+               "streams", "encoded", "late", "fps/stream", "worst-on-time", "avg-enc(ms)", "max-enc(ms)", "passed");
+    }
+}
+
+static void print_result(const BenchOptions *options, uint32_t workers, const BenchResult *result, bool first) {
+    double fps = achieved_fps(result);
+    double average = average_encode_millis(result);
+    double max = (double) result->max_encode_nanos / 1e6;
+    if (strcmp(options->format, "csv") == 0) {
+        printf("%u,%d,%d,%d,%u,%.3f,%llu,%llu,%.2f,%.4f,%.3f,%.3f,%d\n",
+               result->streams, options->width, options->height, options->fps, workers, result->seconds,
+               (unsigned long long) result->encoded_frames, (unsigned long long) result->late_frames, fps,
+               result->worst_on_time, average, max, result->passed);
+    } else if (strcmp(options->format, "json") == 0) {
+        printf("%s\n  {\"streams\": %u, \"width\": %d, \"height\": %d, \"target_fps\": %d, \"workers\": %u, "
+               "\"seconds\": %.3f, \"encoded\": %llu, \"late\": %llu, \"fps_per_stream\": %.2f, "
+               "\"worst_on_time\": %.4f, \"avg_encode_ms\": %.3f, \"max_encode_ms\": %.3f, \"passed\": %s}",
+               first ? "" : ",", result->streams, options->width, options->height, options->fps, workers,
+               result->seconds, (unsigned long long) result->encoded_frames,
+               (unsigned long long) result->late_frames, fps, result->worst_on_time, average, max,
+               result->passed ? "true" : "false");
+    } else {
+        printf("%8u %10llu %8llu %12.2f %13.2f%% %12.3f %12.3f %7s\n", result->streams,
+               (unsigned long long) result->encoded_frames, (unsigned long long) result->late_frames, fps,
+               result->worst_on_time * 100, average, max, result->passed ? "yes" : "no");
+    }
+    fflush(stdout);
+}
+
+static void print_footer(const BenchOptions *options, uint32_t max_passed) {
+    if (strcmp(options->format, "json") == 0) {
+        printf("\n]\n");
+        fprintf(stderr, "max streams at %d fps: %u\n", options->fps, max_passed);
+    } else if (strcmp(options->format, "csv") == 0) {
+        fprintf(stderr, "max streams at %d fps: %u\n", options->fps, max_passed);
+    } else {
+        printf("max streams at %d fps: %u\n", options->fps, max_passed);
+    }
+}
+
+/* the whole clip is read up front, so disk reads do not show up as encode time */
+static uint8_t *load_frames(const BenchOptions *options, uint32_t *frame_count) {
+    size_t frame_size = (size_t) options->width * options->height * 3 / 2;
+    FILE *file = fopen(options->yuv_file, "rb");
+    if (!file) {
+        return NULL;
+    }
+    uint8_t *frames = NULL;
+    uint32_t count = 0, capacity = 0;
+    while (count < options->max_frames) {
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            uint8_t *grown = (uint8_t *) realloc(frames, frame_size * capacity);
+            if (!grown) {
+                break;
+            }
+            frames = grown;
+        }
+        if (fread(frames + frame_size * count, 1, frame_size, file) != frame_size) {
+            break;
+        }
+        ++count;
+    }
+    fclose(file);
+    *frame_count = count;
+    return frames;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "usage: %s [-i yuv_file] [-s widthxheight] [-n max_frames] [-r fps] [-k bitrate_kbps] "
+                    "[-p preset] [-t seconds_per_step] [-m max_streams] [-w workers] [-f table|csv|json]\n", program);
+}
+
+int main(int argc, char **argv) {
+    BenchOptions options = { "data/cuc_ieschool.yuv", 512, 288, 250, 25, 800, "veryfast", 5, 0, 0, "table" };
+    int option;
+    while ((option = getopt(argc, argv, "i:s:n:r:k:p:t:m:w:f:h")) != -1) {
+        switch (option) {
+            case 'i':
+                options.yuv_file = optarg;
+                break;
+            case 's':
+                if (sscanf(optarg, "%dx%d", &options.width, &options.height) != 2) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'n':
+                options.max_frames = (uint32_t) strtoul(optarg, NULL, 10);
+                break;
+            case 'r':
+                options.fps = atoi(optarg);
+                break;
+            case 'k':
+                options.bitrate_kbps = atoi(optarg);
+                break;
+            case 'p':
+                options.preset = optarg;
+                break;
+            case 't':
+                options.seconds = atoi(optarg);
+                break;
+            case 'm':
+                options.max_streams = (uint32_t) strtoul(optarg, NULL, 10);
+                break;
+            case 'w':
+                options.workers = (uint32_t) strtoul(optarg, NULL, 10);
+                break;
+            case 'f':
+                options.format = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (options.width <= 0 || options.height <= 0 || options.width % 2 || options.height % 2 || options.fps <= 0
+        || options.seconds <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t workers = options.workers ? options.workers : (uint32_t) (cpus > 0 ? cpus : 1);
+    if (options.max_streams == 0) {
+        /* well past what the workers can keep up with at any sane resolution */
+        options.max_streams = workers * 16;
+    }
+    if (options.max_streams > ENCODE_SCHEDULER_MAX_STREAMS) {
+        options.max_streams = ENCODE_SCHEDULER_MAX_STREAMS;
+    }
+
+    uint32_t frame_count = 0;
+    uint8_t *frames = load_frames(&options, &frame_count);
+    if (!frames || frame_count == 0) {
+        fprintf(stderr, "reading %s failed, see the usage comment in %s\n", options.yuv_file, __FILE__);
+        free(frames);
+        return 1;
+    }
+
+    uint32_t max_passed = 0;
+    print_header(&options, workers);
+    for (uint32_t streams = 1; streams <= options.max_streams; ++streams) {
+        BenchResult result;
+        memset(&result, 0, sizeof(result));
+        if (!run_step(&options, frames, frame_count, streams, &result)) {
+            break;
+        }
+        print_result(&options, workers, &result, streams == 1);
+        if (!result.passed) {
+            break;
+        }
+        max_passed = streams;
+    }
+    print_footer(&options, max_passed);
+    free(frames);
+    return 0;
+}